@@ -0,0 +1,5 @@
+// per object data, filled from a UniformBufferRing
+layout (std140) uniform ObjectData
+{
+    mat4 modelMatrix;
+};
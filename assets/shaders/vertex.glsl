@@ -3,12 +3,37 @@
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec3 colorRGB;
 
-uniform mat4 modelMatrix;
+#ifdef SKINNING
+// VertexSkin: palette indices and unorm8 weights
+layout (location = 2) in vec4 jointIndices;
+layout (location = 3) in vec4 jointWeights;
+// palettes of all instances of this draw, JOINT_COUNT matrices each (SkinnedMeshBatch)
+layout (std140) uniform SkinData
+{
+    mat4 palette[SKIN_PALETTE_SIZE];
+};
+#elif defined(INSTANCED)
+// per instance model matrix from an InstanceBuffer (locations 4 - 7, divisor 1)
+layout (location = 4) in mat4 instanceMatrix;
+#else
+#include "object_data.glsl"
+#endif
 
 out vec3 colorVS;
 
 void main(){
     colorVS = colorRGB;
+#ifdef SKINNING
+    int base = gl_InstanceID * JOINT_COUNT;
+    mat4 skin = jointWeights.x * palette[base + int(jointIndices.x)]
+              + jointWeights.y * palette[base + int(jointIndices.y)]
+              + jointWeights.z * palette[base + int(jointIndices.z)]
+              + jointWeights.w * palette[base + int(jointIndices.w)];
+    gl_Position = skin * vec4(pos, 1.0);
+#elif defined(INSTANCED)
+    gl_Position = instanceMatrix * vec4(pos, 1.0);
+#else
     gl_Position = modelMatrix * vec4(pos, 1.0);
+#endif
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,111 @@
+#include <AnimationSystem.h>
+#include "BenchmarkUtils.h"
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//Sampling a crowd of animated rigs per frame. A clip with 16 joints and 64 keys per track is played on many instances,
+//half of them crossfading. Timed are AnimationSystem::update without and with a sample budget, and
+//AnimationClip::sample for every instance with and without key cursors.
+//Usage: AnimationBenchmark [instances] [budget] [frames]
+
+namespace
+{
+	const uint32_t JOINTS = 16;
+	const uint32_t KEYS = 64;
+
+	void addKeys(AnimationClip& clip, float phase)
+	{
+		for (uint32_t j = 0; j < JOINTS; j++)
+		{
+			for (uint32_t k = 0; k < KEYS; k++)
+			{
+				float time = clip.getDuration() * k / (KEYS - 1);
+				float angle = std::sin(time * 2.0f + j + phase) * 0.5f;
+				clip.addPositionKey(j, time, glm::vec3(0.0f, j * 0.1f, std::cos(time + phase) * 0.05f));
+				clip.addRotationKey(j, time, glm::angleAxis(angle, glm::vec3(1.0f, 0.0f, 0.0f)));
+				clip.addScaleKey(j, time, glm::vec3(1.0f + angle * 0.1f));
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int instances = argc > 1 ? std::stoi(argv[1]) : 4096;
+	int budget = argc > 2 ? std::stoi(argv[2]) : 1024;
+	int frames = argc > 3 ? std::stoi(argv[3]) : 100;
+	const float dt = 1.0f / 60.0f;
+
+	AnimationClip walk("walk", 2.0f, JOINTS);
+	AnimationClip idle("idle", 3.0f, JOINTS);
+	addKeys(walk, 0.0f);
+	addKeys(idle, 1.0f);
+
+	AnimationSystem system(JOINTS);
+	for (int i = 0; i < instances; i++)
+	{
+		AnimationSystem::InstanceId id = system.createInstance(&idle, i * 0.37f);
+		if (i % 2 == 0)
+			system.play(id, &walk, 1e6f);	//still fading for the whole benchmark
+	}
+
+	//the checksum keeps the compiler from dropping the samples
+	float checksum = 0.0f;
+	system.setSampleBudget(0);
+	double all = BenchmarkUtils::bestOf(5, [&]()
+	{
+		for (int f = 0; f < frames; f++)
+		{
+			system.update(dt);
+			checksum += system.getPose(static_cast<AnimationSystem::InstanceId>(f % instances))->position.z;
+		}
+	}) / frames;
+
+	system.setSampleBudget(static_cast<size_t>(budget));
+	double budgeted = BenchmarkUtils::bestOf(5, [&]()
+	{
+		for (int f = 0; f < frames; f++)
+		{
+			system.update(dt);
+			checksum += system.getPose(static_cast<AnimationSystem::InstanceId>(f % instances))->position.z;
+		}
+	}) / frames;
+
+	//one clip per instance, sampled directly
+	std::vector<JointPose> poses(JOINTS);
+	std::vector<uint32_t> cursors(walk.getCursorSize() * instances, 0);
+	double withCursor = 0.0, withoutCursor = 0.0;
+	float time = 0.0f;
+	withCursor = BenchmarkUtils::bestOf(5, [&]()
+	{
+		for (int f = 0; f < frames; f++, time += dt)
+		{
+			for (int i = 0; i < instances; i++)
+			{
+				walk.sample(std::fmod(time + i * 0.37f, walk.getDuration()), poses.data(), &cursors[i * walk.getCursorSize()]);
+				checksum += poses[0].position.z;
+			}
+		}
+	}) / frames;
+	time = 0.0f;
+	withoutCursor = BenchmarkUtils::bestOf(5, [&]()
+	{
+		for (int f = 0; f < frames; f++, time += dt)
+		{
+			for (int i = 0; i < instances; i++)
+			{
+				walk.sample(std::fmod(time + i * 0.37f, walk.getDuration()), poses.data());
+				checksum += poses[0].position.z;
+			}
+		}
+	}) / frames;
+
+	std::cout << instances << " instances of " << JOINTS << " joints, " << KEYS << " keys per track, half crossfading, best of 5 x "
+		<< frames << " frames (checksum " << checksum << ")\n";
+	std::cout << "  AnimationSystem::update, all instances:   " << all << " ms/frame\n";
+	std::cout << "  AnimationSystem::update, budget " << budget << ":      " << budgeted << " ms/frame\n";
+	std::cout << "  AnimationClip::sample with cursors:       " << withCursor << " ms/frame\n";
+	std::cout << "  AnimationClip::sample with binary search: " << withoutCursor << " ms/frame\n";
+	return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef _BENCHMARK_UTILS_H_
+#define _BENCHMARK_UTILS_H_
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+//Timing and test data helpers shared by the benchmarks.
+class BenchmarkUtils
+{
+private:
+	BenchmarkUtils();
+	~BenchmarkUtils();
+
+public:
+	//milliseconds since an arbitrary start
+	static double now()
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	//fastest of runs calls of f in milliseconds
+	template <typename F>
+	static double bestOf(int runs, F f)
+	{
+		double best = 1e300;
+		for (int i = 0; i < runs; i++)
+		{
+			double start = now();
+			f();
+			best = std::min(best, now() - start);
+		}
+		return best;
+	}
+
+	//Writes a size x size grid of quads with positions, uvs and normals, split into two triangles per quad.
+	//Vertices are shared between faces like in a scanned or modelled mesh, so the dedup sees (size + 1)^2 unique
+	//vertices for 2 * size^2 triangles.
+	static void writeGridOBJ(const std::string& path, int size)
+	{
+		std::ofstream stream(path);
+		if (!stream)
+			throw std::logic_error("Can't write " + path);
+		stream << "o grid\ng surface\n";
+		for (int y = 0; y <= size; y++)
+		{
+			for (int x = 0; x <= size; x++)
+				stream << "v " << x * 0.01f << " " << std::sin(x * 0.1f) * std::cos(y * 0.07f) << " " << y * 0.01f << "\n";
+		}
+		for (int y = 0; y <= size; y++)
+		{
+			for (int x = 0; x <= size; x++)
+				stream << "vt " << x / static_cast<float>(size) << " " << y / static_cast<float>(size) << "\n";
+		}
+		for (int y = 0; y <= size; y++)
+		{
+			for (int x = 0; x <= size; x++)
+				stream << "vn 0 1 0\n";
+		}
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				int a = y * (size + 1) + x + 1;	//OBJ indices start at 1
+				int b = a + 1;
+				int c = a + size + 1;
+				int d = c + 1;
+				stream << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << d << "/" << d << "/" << d << "\n";
+				stream << "f " << a << "/" << a << "/" << a << " " << d << "/" << d << "/" << d << " " << c << "/" << c << "/" << c << "\n";
+			}
+		}
+	}
+
+	static double fileSizeMB(const std::string& path)
+	{
+		std::ifstream stream(path, std::ios_base::binary | std::ios_base::ate);
+		return static_cast<double>(stream.tellg()) / (1024.0 * 1024.0);
+	}
+};
+
+#endif
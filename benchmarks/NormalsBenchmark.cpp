@@ -0,0 +1,124 @@
+//OBJLoader::recalculateNormals / recalculateTangents, single and multi threaded, against the previous single threaded
+//implementation, which is kept below as the reference.
+//Usage: NormalsBenchmark [triangles in millions] [threads]
+//Default: 10M triangles of a height field grid, all hardware threads.
+#include <OBJLoader.h>
+#include "BenchmarkUtils.h"
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+	void scalarNormals(OBJMesh& mesh)
+	{
+		for (auto& v : mesh.vertices)
+			v.normal = glm::vec3(0.0f);
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			Vertex& v1 = mesh.vertices[mesh.indices[i]];
+			Vertex& v2 = mesh.vertices[mesh.indices[i + 1]];
+			Vertex& v3 = mesh.vertices[mesh.indices[i + 2]];
+			glm::vec3 n = glm::cross(v2.position - v1.position, v3.position - v1.position);
+			v1.normal += n;
+			v2.normal += n;
+			v3.normal += n;
+		}
+		for (auto& v : mesh.vertices)
+			v.normal = glm::normalize(v.normal);
+	}
+
+	void scalarTangents(OBJMesh& mesh)
+	{
+		for (auto& v : mesh.vertices)
+			v.tangent = glm::vec3(0.0f);
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			Vertex& v1 = mesh.vertices[mesh.indices[i]];
+			Vertex& v2 = mesh.vertices[mesh.indices[i + 1]];
+			Vertex& v3 = mesh.vertices[mesh.indices[i + 2]];
+			glm::vec3 e1 = v2.position - v1.position;
+			glm::vec3 e2 = v3.position - v1.position;
+			glm::vec2 d1 = v2.uv - v1.uv;
+			glm::vec2 d2 = v3.uv - v1.uv;
+			float det = d1.x * d2.y - d2.x * d1.y;
+			glm::vec3 tangent(1.0f, 0.0f, 0.0f);
+			if (std::abs(det) >= 1e-6f)
+				tangent = (1.0f / det) * (d2.y * e1 - d1.y * e2);
+			v1.tangent += tangent;
+			v2.tangent += tangent;
+			v3.tangent += tangent;
+		}
+		for (auto& v : mesh.vertices)
+		{
+			v.normal = glm::normalize(v.normal);
+			v.tangent = glm::normalize(v.tangent);
+			v.tangent = glm::normalize(v.tangent - glm::dot(v.normal, v.tangent) * v.normal);
+		}
+	}
+
+	//largest distance between the normals and tangents of a and b
+	void compare(const OBJMesh& a, const OBJMesh& b, float& normalerror, float& tangenterror)
+	{
+		normalerror = tangenterror = 0.0f;
+		for (size_t i = 0; i < a.vertices.size(); i++)
+		{
+			normalerror = std::max(normalerror, glm::length(a.vertices[i].normal - b.vertices[i].normal));
+			tangenterror = std::max(tangenterror, glm::length(a.vertices[i].tangent - b.vertices[i].tangent));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double millions = argc > 1 ? std::atof(argv[1]) : 10.0;
+	unsigned int threads = argc > 2 ? static_cast<unsigned int>(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	int size = static_cast<int>(std::sqrt(millions * 1e6 / 2.0));
+
+	OBJMesh mesh;
+	mesh.hasUVs = true;
+	mesh.vertices.resize(static_cast<size_t>(size + 1) * (size + 1));
+	for (int y = 0; y <= size; y++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			Vertex& v = mesh.vertices[y * (size + 1) + x];
+			v.position = glm::vec3(x * 0.01f, std::sin(x * 0.1f) * std::cos(y * 0.07f), y * 0.01f);
+			v.uv = glm::vec2(x * 0.01f, y * 0.013f);	//large enough steps, tiny uv triangles count as degenerate
+		}
+	}
+	mesh.indices.reserve(static_cast<size_t>(size) * size * 6);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			Index a = y * (size + 1) + x;
+			Index c = a + size + 1;
+			Index quad[6] = { a, a + 1, c + 1, a, c + 1, c };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+	std::printf("%zu triangles, %zu vertices\n", mesh.indices.size() / 3, mesh.vertices.size());
+
+	OBJMesh reference = mesh;
+	double tnormals = BenchmarkUtils::bestOf(5, [&]() { scalarNormals(reference); });
+	double ttangents = BenchmarkUtils::bestOf(5, [&]() { scalarTangents(reference); });
+	std::printf("  reference             %8.1f ms normals %8.1f ms tangents\n", tnormals, ttangents);
+
+	unsigned int counts[2] = { 1, threads };
+	for (int i = 0; i < (threads > 1 ? 2 : 1); i++)
+	{
+		double n = BenchmarkUtils::bestOf(5, [&]() { OBJLoader::recalculateNormals(mesh, counts[i]); });
+		double t = BenchmarkUtils::bestOf(5, [&]() { OBJLoader::recalculateTangents(mesh, counts[i]); });
+		float normalerror, tangenterror;
+		compare(mesh, reference, normalerror, tangenterror);
+		std::printf("  %2u thread(s)          %8.1f ms normals %8.1f ms tangents  %.1fx / %.1fx  max error %.2g / %.2g\n",
+			counts[i], n, t, tnormals / n, ttangents / t, normalerror, tangenterror);
+		if (normalerror > 1e-4f || tangenterror > 1e-3f)
+		{
+			std::printf("  results differ from the reference\n");
+			return 1;
+		}
+	}
+	return 0;
+}
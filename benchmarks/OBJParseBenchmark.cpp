@@ -0,0 +1,75 @@
+//Compares the istream parser (OBJLoader::loadOBJ) with the memory mapped one (OBJLoader::loadOBJMapped).
+//Usage: OBJParseBenchmark [file.obj] [threads]
+//Without a file a grid of 1000 x 1000 quads (about 165 MB) is written to benchmark_grid.obj first.
+#include <OBJLoader.h>
+#include "BenchmarkUtils.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	bool sameResult(const OBJResult& a, const OBJResult& b)
+	{
+		if (a.objects.size() != b.objects.size())
+			return false;
+		for (size_t o = 0; o < a.objects.size(); o++)
+		{
+			const OBJObject& x = a.objects[o];
+			const OBJObject& y = b.objects[o];
+			if (x.name != y.name || x.meshes.size() != y.meshes.size())
+				return false;
+			for (size_t m = 0; m < x.meshes.size(); m++)
+			{
+				const OBJMesh& p = x.meshes[m];
+				const OBJMesh& q = y.meshes[m];
+				if (p.name != q.name || p.indices != q.indices || p.vertices.size() != q.vertices.size() ||
+					p.hasUVs != q.hasUVs || p.hasNormals != q.hasNormals || p.hasTangents != q.hasTangents)
+					return false;
+				//attributes the file doesn't have are left uninitialized
+				for (size_t v = 0; v < p.vertices.size(); v++)
+				{
+					const Vertex& s = p.vertices[v];
+					const Vertex& t = q.vertices[v];
+					if (std::memcmp(&s.position, &t.position, sizeof(glm::vec3)) != 0 ||
+						(p.hasUVs && std::memcmp(&s.uv, &t.uv, sizeof(glm::vec2)) != 0) ||
+						(p.hasNormals && std::memcmp(&s.normal, &t.normal, sizeof(glm::vec3)) != 0) ||
+						(p.hasTangents && std::memcmp(&s.tangent, &t.tangent, sizeof(glm::vec3)) != 0))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::string path = argc > 1 ? argv[1] : "benchmark_grid.obj";
+		unsigned int threads = argc > 2 ? static_cast<unsigned int>(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+		if (argc <= 1)
+			BenchmarkUtils::writeGridOBJ(path, 1000);
+		double mb = BenchmarkUtils::fileSizeMB(path);
+
+		OBJResult streamed, mapped, parallel;
+		double tstream = BenchmarkUtils::bestOf(3, [&]() { streamed = OBJLoader::loadOBJ(path); });
+		double tmapped = BenchmarkUtils::bestOf(3, [&]() { mapped = OBJLoader::loadOBJMapped(path, false, false, 1); });
+		double tparallel = BenchmarkUtils::bestOf(3, [&]() { parallel = OBJLoader::loadOBJMapped(path, false, false, threads); });
+
+		std::printf("%s: %.1f MB\n", path.c_str(), mb);
+		std::printf("  loadOBJ (istream)          %8.1f ms %8.1f MB/s\n", tstream, mb / tstream * 1000.0);
+		std::printf("  loadOBJMapped, 1 thread    %8.1f ms %8.1f MB/s  %.1fx\n", tmapped, mb / tmapped * 1000.0, tstream / tmapped);
+		std::printf("  loadOBJMapped, %2u threads  %8.1f ms %8.1f MB/s  %.1fx\n", threads, tparallel, mb / tparallel * 1000.0, tstream / tparallel);
+		bool same = sameResult(streamed, mapped) && sameResult(streamed, parallel);
+		std::printf("  results identical: %s\n", same ? "yes" : "NO");
+		return same ? 0 : 1;
+	}
+	catch (const std::exception& ex)
+	{
+		std::fprintf(stderr, "%s\n", ex.what());
+		return 1;
+	}
+}
@@ -0,0 +1,220 @@
+#include <Transform.h>
+#include "BenchmarkUtils.h"
+#include <iostream>
+#include <vector>
+
+//The robot of the original Scene::render: eight parts, each built from a fresh Transform with scale, translate and
+//rotateAroundPoint and then moved below its parent with setMatrix(parent * getMatrix()).
+//Transform stores set matrices as is and decomposes them on demand. The previous implementation decomposed every
+//set matrix right away; it is kept below as the reference.
+//Usage: RobotTransformBenchmark [robots] [frames]
+
+namespace
+{
+	//Transform before lazy decomposition, reduced to the operations the robot uses
+	class PreviousTransform
+	{
+	public:
+		PreviousTransform() :
+			m_transformMatrix(),
+			m_matrixDirty(true),
+			m_position(0.0f),
+			m_rotation(glm::vec3(0, 0, 0)),
+			m_scale(1.0f),
+			m_xaxis(1.0f, 0.0f, 0.0f),
+			m_yaxis(0.0f, 1.0f, 0.0f),
+			m_zaxis(0.0f, 1.0f, 0.0f)
+		{}
+
+		PreviousTransform(const glm::mat4& transformMatrix) :
+			m_transformMatrix(transformMatrix),
+			m_matrixDirty(true),
+			m_position(transformMatrix[3]),
+			m_rotation(glm::quat_cast(transformMatrix)),
+			m_scale(glm::length(glm::vec3(transformMatrix[0])), glm::length(glm::vec3(transformMatrix[1])), glm::length(glm::vec3(transformMatrix[2]))),
+			m_xaxis(glm::normalize(glm::vec3(transformMatrix[0]))),
+			m_yaxis(glm::normalize(glm::vec3(transformMatrix[1]))),
+			m_zaxis(glm::normalize(glm::vec3(transformMatrix[2])))
+		{}
+
+		const glm::mat4& getMatrix()
+		{
+			if (m_matrixDirty)
+			{
+				m_transformMatrix = glm::translate(m_position) * glm::toMat4(m_rotation) * glm::scale(m_scale);
+				m_xaxis = glm::normalize(glm::vec3(m_transformMatrix[0]));
+				m_yaxis = glm::normalize(glm::vec3(m_transformMatrix[1]));
+				m_zaxis = glm::normalize(glm::vec3(m_transformMatrix[2]));
+				m_matrixDirty = false;
+			}
+			return m_transformMatrix;
+		}
+
+		void setMatrix(const glm::mat4& matrix)
+		{
+			PreviousTransform tmp(matrix);
+			m_position = tmp.m_position;
+			m_rotation = tmp.m_rotation;
+			m_scale = tmp.m_scale;
+			m_transformMatrix = matrix;
+			m_xaxis = tmp.m_xaxis;
+			m_yaxis = tmp.m_yaxis;
+			m_zaxis = tmp.m_zaxis;
+			m_matrixDirty = false;
+		}
+
+		void translate(const glm::vec3& deltaPos)
+		{
+			m_position += deltaPos;
+			m_matrixDirty = true;
+		}
+
+		void rotate(const glm::quat& deltaRot)
+		{
+			m_rotation = glm::normalize(deltaRot * m_rotation);
+			m_matrixDirty = true;
+		}
+
+		void scale(const glm::vec3& scale)
+		{
+			m_scale *= scale;
+			m_matrixDirty = true;
+		}
+
+		void rotateAroundPoint(const glm::vec3 point, const glm::quat& deltaRot)
+		{
+			glm::mat4 mm = getMatrix();
+			mm = glm::translate(-point) * mm;
+			mm = glm::toMat4(deltaRot) * mm;
+			mm = glm::translate(point) * mm;
+			setMatrix(mm);
+		}
+
+	private:
+		glm::mat4 m_transformMatrix;
+		bool m_matrixDirty;
+		glm::vec3 m_position;
+		glm::quat m_rotation;
+		glm::vec3 m_scale;
+		glm::vec3 m_xaxis;
+		glm::vec3 m_yaxis;
+		glm::vec3 m_zaxis;
+	};
+
+	//one robot like the original Scene::render, the eight part matrices are written to out
+	template <typename T>
+	void robot(const glm::mat4& robotTransform, float angle, float time, glm::mat4* out)
+	{
+		glm::vec3 rotation(0.0f, angle * -0.1f, 0.0f);
+		float swingAngle = std::sin(time) * glm::radians(30.0f);
+		float armSwingAngle = std::sin(time) * glm::radians(20.0f);
+
+		T body;
+		body.scale(glm::vec3(1.0f, 1.5f, 0.5f));
+		body.setMatrix(robotTransform * body.getMatrix());
+		out[0] = body.getMatrix();
+
+		T head;
+		head.scale(glm::vec3(0.5f));
+		head.translate(glm::vec3(0.0f, 1.25f, 0.0f));
+		head.rotate(glm::quat(rotation));
+		head.setMatrix(robotTransform * head.getMatrix());
+		out[1] = head.getMatrix();
+
+		T leftLeg;
+		leftLeg.scale(glm::vec3(0.5f, 1.0f, 0.5f));
+		leftLeg.translate(glm::vec3(-0.25f, -1.25f, 0.0f));
+		leftLeg.rotateAroundPoint(glm::vec3(-0.25f, 0.0f, 0.0f), glm::quat(glm::vec3(swingAngle, 0.0f, 0.0f)));
+		leftLeg.setMatrix(robotTransform * leftLeg.getMatrix());
+		out[2] = leftLeg.getMatrix();
+
+		T rightLeg;
+		rightLeg.scale(glm::vec3(0.5f, 1.0f, 0.5f));
+		rightLeg.translate(glm::vec3(0.25f, -1.25f, 0.0f));
+		rightLeg.rotateAroundPoint(glm::vec3(0.25f, 0.0f, 0.0f), glm::quat(glm::vec3(-swingAngle, 0.0f, 0.0f)));
+		rightLeg.setMatrix(robotTransform * rightLeg.getMatrix());
+		out[3] = rightLeg.getMatrix();
+
+		T leftUpperArm;
+		leftUpperArm.scale(glm::vec3(0.2f, 0.75f, 0.25f));
+		leftUpperArm.translate(glm::vec3(-0.75f, 0.35f, 0.0f));
+		leftUpperArm.rotateAroundPoint(glm::vec3(-1.0f, 1.0f, 0.0f), glm::quat(glm::vec3(armSwingAngle, 0.0f, 0.0f)));
+		leftUpperArm.setMatrix(robotTransform * leftUpperArm.getMatrix());
+		out[4] = leftUpperArm.getMatrix();
+
+		T rightUpperArm;
+		rightUpperArm.scale(glm::vec3(0.2f, 0.75f, 0.25f));
+		rightUpperArm.translate(glm::vec3(0.75f, 0.35f, 0.0f));
+		rightUpperArm.rotateAroundPoint(glm::vec3(0.75f, 0.75f, 0.0f), glm::quat(glm::vec3(-armSwingAngle, 0.0f, 0.0f)));
+		rightUpperArm.setMatrix(robotTransform * rightUpperArm.getMatrix());
+		out[5] = rightUpperArm.getMatrix();
+
+		T leftLowerArm;
+		leftLowerArm.translate(glm::vec3(0.0f, -1.0f, 0.0f));
+		leftLowerArm.rotateAroundPoint(glm::vec3(0.0f, -1.0f, 0.0f), glm::quat(glm::vec3(armSwingAngle, 0.0f, 0.0f)));
+		leftLowerArm.setMatrix(leftUpperArm.getMatrix() * leftLowerArm.getMatrix());
+		out[6] = leftLowerArm.getMatrix();
+
+		T rightLowerArm;
+		rightLowerArm.translate(glm::vec3(0.0f, -1.0f, 0.0f));
+		rightLowerArm.rotateAroundPoint(glm::vec3(0.0f, -1.0f, 0.0f), glm::quat(glm::vec3(-armSwingAngle, 0.0f, 0.0f)));
+		rightLowerArm.setMatrix(rightUpperArm.getMatrix() * rightLowerArm.getMatrix());
+		out[7] = rightLowerArm.getMatrix();
+	}
+
+	//milliseconds per frame of all robots, fastest of five runs
+	template <typename T>
+	double measure(const std::vector<glm::mat4>& roots, int frames, std::vector<glm::mat4>& matrices)
+	{
+		return BenchmarkUtils::bestOf(5, [&]()
+		{
+			for (int f = 0; f < frames; f++)
+			{
+				for (size_t r = 0; r < roots.size(); r++)
+					robot<T>(roots[r], f * 0.016f, f * 0.016f + r * 0.37f, &matrices[r * 8]);
+			}
+		}) / frames;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int robots = argc > 1 ? std::stoi(argv[1]) : 1024;
+	int frames = argc > 2 ? std::stoi(argv[2]) : 100;
+
+	//a grid of small robots like the crowd of Scene
+	std::vector<glm::mat4> roots(robots);
+	for (int i = 0; i < robots; i++)
+	{
+		glm::mat4 root = glm::translate(glm::mat4(1.0f), glm::vec3(-0.95f + (i % 32) * 0.06f, -0.95f + (i / 32) * 0.06f, 0.0f));
+		root = glm::rotate(root, glm::radians(-40.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		roots[i] = glm::scale(root, glm::vec3(0.016f));
+	}
+
+	std::vector<glm::mat4> previous(robots * 8);
+	std::vector<glm::mat4> lazy(robots * 8);
+	double tprevious = measure<PreviousTransform>(roots, frames, previous);
+	double tlazy = measure<Transform>(roots, frames, lazy);
+
+	//both ran the same last frame
+	float maxError = 0.0f;
+	for (size_t i = 0; i < lazy.size(); i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+				maxError = std::max(maxError, std::abs(lazy[i][c][r] - previous[i][c][r]));
+		}
+	}
+
+	std::cout << robots << " robots of 8 parts, best of 5 x " << frames << " frames\n";
+	std::cout << "  previous Transform (decomposes every setMatrix): " << tprevious << " ms/frame\n";
+	std::cout << "  Transform (decomposes on demand):                " << tlazy << " ms/frame\n";
+	std::cout << "  max difference of the part matrices: " << maxError << "\n";
+	if (maxError > 1e-5f)
+	{
+		std::cerr << "Transform matrices differ from the previous implementation.\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include <Transform.h>
+#include <TransformSystem.h>
+#include "BenchmarkUtils.h"
+#include <iostream>
+#include <vector>
+
+//Composing the model matrices of many objects per frame: one Transform per object against one TransformSystem.
+//Every frame rotates all objects and reads their matrices, then a frame without changes is timed as well.
+//Usage: TransformSystemBenchmark [objects] [frames]
+
+int main(int argc, char** argv)
+{
+	int objects = argc > 1 ? std::stoi(argv[1]) : 10000;
+	int frames = argc > 2 ? std::stoi(argv[2]) : 100;
+
+	std::vector<glm::vec3> positions(objects);
+	std::vector<glm::quat> rotations(objects);
+	std::vector<glm::vec3> scales(objects);
+	for (int i = 0; i < objects; i++)
+	{
+		positions[i] = glm::vec3(i % 100, (i / 100) % 100, i / 10000) * 2.0f;
+		rotations[i] = glm::angleAxis(i * 0.01f, glm::normalize(glm::vec3(1.0f, i % 7 + 1.0f, 0.5f)));
+		scales[i] = glm::vec3(1.0f + (i % 5) * 0.25f, 1.0f, 1.0f + (i % 3) * 0.5f);
+	}
+	const glm::quat spin = glm::angleAxis(0.001f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	std::vector<Transform> transforms;
+	transforms.reserve(objects);
+	for (int i = 0; i < objects; i++)
+		transforms.emplace_back(positions[i], rotations[i], scales[i]);
+
+	TransformSystem system;
+	system.reserve(objects);
+	std::vector<TransformSystem::Handle> handles(objects);
+	for (int i = 0; i < objects; i++)
+		handles[i] = system.create(positions[i], rotations[i], scales[i]);
+	system.update();
+
+	//the checksum keeps the compiler from dropping the matrix reads
+	float checksum = 0.0f;
+	std::vector<glm::quat> current(rotations);
+	double perObject = BenchmarkUtils::bestOf(5, [&]()
+	{
+		for (int f = 0; f < frames; f++)
+		{
+			for (int i = 0; i < objects; i++)
+			{
+				current[i] = spin * current[i];
+				transforms[i].setRotation(current[i]);
+				checksum += transforms[i].getMatrix()[3][0];
+			}
+		}
+	}) / frames;
+
+	current = rotations;
+	double batched = BenchmarkUtils::bestOf(5, [&]()
+	{
+		for (int f = 0; f < frames; f++)
+		{
+			for (int i = 0; i < objects; i++)
+			{
+				current[i] = spin * current[i];
+				system.setRotation(handles[i], current[i]);
+			}
+			system.update();
+			const glm::mat4* matrices = system.getMatrices();
+			for (size_t i = 0; i < system.size(); i++)
+				checksum += matrices[i][3][0];
+		}
+	}) / frames;
+
+	double unchanged = BenchmarkUtils::bestOf(5, [&]()
+	{
+		for (int f = 0; f < frames; f++)
+			system.update();
+	}) / frames;
+
+	//both hold the same rotations now, compare against the composition Transform uses
+	float maxError = 0.0f;
+	for (int i = 0; i < objects; i++)
+	{
+		glm::mat4 reference = glm::translate(positions[i]) * glm::toMat4(system.getRotation(handles[i])) * glm::scale(scales[i]);
+		const glm::mat4& m = system.getMatrix(handles[i]);
+		const glm::mat4& t = transforms[i].getMatrix();
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+				maxError = std::max(maxError, std::max(std::abs(m[c][r] - reference[c][r]), std::abs(t[c][r] - reference[c][r])));
+		}
+	}
+
+	std::cout << objects << " objects, all rotated every frame, best of 5 x " << frames << " frames (checksum " << checksum << ")\n";
+	std::cout << "  Transform::setRotation + getMatrix:     " << perObject << " ms/frame\n";
+	std::cout << "  TransformSystem::setRotation + update:  " << batched << " ms/frame\n";
+	std::cout << "  TransformSystem::update, nothing moved: " << unchanged << " ms/frame\n";
+	std::cout << "  max difference to translate * rotate * scale: " << maxError << "\n";
+	if (maxError > 1e-5f)
+	{
+		std::cerr << "TransformSystem matrices differ from Transform.\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,149 @@
+#include <ShaderProgram.h>
+#include "BenchmarkUtils.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+//CPU cost of setUniform(mat4) per draw, like the modelMatrix update in Scene::render.
+//Needs a window system with OpenGL 3.3: a hidden GLFW window provides the context.
+//Usage: UniformBenchmark [calls]
+
+namespace
+{
+	const char* vertexSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 position;\n"
+		"uniform mat4 modelMatrix;\n"
+		"uniform mat4 viewProjMatrix;\n"
+		"void main() { gl_Position = viewProjMatrix * modelMatrix * vec4(position, 1.0); }\n";
+
+	const char* fragmentSource =
+		"#version 330 core\n"
+		"uniform vec4 tint;\n"
+		"out vec4 color;\n"
+		"void main() { color = tint; }\n";
+
+	GLuint compile(GLenum type, const char* source)
+	{
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+		GLint status = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE)
+			throw std::logic_error("Benchmark shader doesn't compile.");
+		return shader;
+	}
+
+	GLuint link()
+	{
+		GLuint vs = compile(GL_VERTEX_SHADER, vertexSource);
+		GLuint fs = compile(GL_FRAGMENT_SHADER, fragmentSource);
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vs);
+		glAttachShader(program, fs);
+		glLinkProgram(program);
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE)
+			throw std::logic_error("Benchmark shader doesn't link.");
+		return program;
+	}
+
+	//setUniform before the location table: the bound program and the location are queried on every call
+	bool setUniformQueried(GLuint program, const std::string& name, const glm::mat4& value)
+	{
+		GLint loc = glGetUniformLocation(program, name.c_str());
+		if (loc == -1)
+			return false;
+		GLint current = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+		if (static_cast<GLuint>(current) != program)
+			return false;
+		glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]);
+		return true;
+	}
+
+	//per call in nanoseconds, fastest of five runs
+	template <typename F>
+	double measure(int calls, F f)
+	{
+		std::vector<glm::mat4> matrices(64);
+		for (size_t i = 0; i < matrices.size(); i++)
+			matrices[i] = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+		bool ok = true;
+		double ms = BenchmarkUtils::bestOf(5, [&]()
+		{
+			for (int i = 0; i < calls; i++)
+				ok &= f(matrices[i & 63]);
+			glFinish();
+		});
+		if (!ok)
+			throw std::logic_error("setUniform failed during the benchmark.");
+		return ms * 1e6 / calls;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int calls = argc > 1 ? std::stoi(argv[1]) : 1000000;
+
+	if (!glfwInit())
+	{
+		std::cerr << "Failed to initialize GLFW\n";
+		return 1;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "UniformBenchmark", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cerr << "Failed to create an OpenGL 3.3 context\n";
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK)
+	{
+		std::cerr << "Failed to initialize GLEW\n";
+		glfwTerminate();
+		return 1;
+	}
+	glGetError(); //dummy readout
+
+	int result = 0;
+	try
+	{
+		ShaderProgram program(link());
+		program.use();
+		const std::string name = "modelMatrix";
+		UniformHandle handle = program.getUniformHandle(name);
+		GLuint id = program.prog;
+
+		double queried = measure(calls, [&](const glm::mat4& m) { return setUniformQueried(id, name, m); });
+		double byName = measure(calls, [&](const glm::mat4& m) { return program.setUniform(name, m, false); });
+		double byHandle = measure(calls, [&](const glm::mat4& m) { return program.setUniform(handle, m, false); });
+		double direct = measure(calls, [&](const glm::mat4& m) { glUniformMatrix4fv(handle.location, 1, GL_FALSE, &m[0][0]); return true; });
+
+		std::cout << "setUniform(mat4), " << calls << " calls, " << glGetString(GL_RENDERER) << "\n";
+		std::cout << "  glGetUniformLocation + glGetIntegerv: " << queried << " ns/call\n";
+		std::cout << "  setUniform(name), location table:     " << byName << " ns/call\n";
+		std::cout << "  setUniform(handle):                   " << byHandle << " ns/call\n";
+		std::cout << "  glUniformMatrix4fv only:              " << direct << " ns/call\n";
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << ex.what() << "\n";
+		result = 1;
+	}
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return result;
+}
@@ -0,0 +1,176 @@
+//Face vertex deduplication: VertexHashTable against the std::unordered_map the loader used before.
+//Usage: VertexDedupBenchmark [gridsize]
+//A gridsize x gridsize quad grid gives 2 * gridsize^2 triangles and (gridsize + 1)^2 unique vertices (default 1000: 2M faces).
+//Keys are deduplicated in file order and in shuffled triangle order; peak heap memory is counted through operator new.
+#include <VertexHashTable.h>
+#include "BenchmarkUtils.h"
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <cstddef>
+
+namespace
+{
+	size_t currentBytes = 0;
+	size_t peakBytes = 0;
+
+	struct VertexKeyHash
+	{
+		size_t operator()(const VertexKey& key) const
+		{
+			size_t h = key.p;
+			h = h * 31 + key.uv;
+			h = h * 31 + key.n;
+			return h * 31 + key.defined;
+		}
+	};
+
+	//dedups keys, returns the number of unique vertices; peak heap use above the start goes to peak
+	template <typename Dedup>
+	size_t run(const std::vector<VertexKey>& keys, std::vector<Index>& indices, size_t& peak, Dedup dedup)
+	{
+		size_t base = currentBytes;
+		peakBytes = currentBytes;
+		size_t unique = dedup(keys, indices);
+		peak = peakBytes - base;
+		return unique;
+	}
+}
+
+namespace
+{
+	//in front of every allocation so delete knows how much is released, sized to keep the alignment of new
+	union AllocationHeader
+	{
+		size_t size;
+		std::max_align_t align;
+	};
+
+	void* countedAlloc(size_t size)
+	{
+		AllocationHeader* header = static_cast<AllocationHeader*>(std::malloc(sizeof(AllocationHeader) + size));
+		if (!header)
+			throw std::bad_alloc();
+		header->size = size;
+		currentBytes += size;
+		peakBytes = std::max(peakBytes, currentBytes);
+		return header + 1;
+	}
+
+	void countedFree(void* ptr)
+	{
+		if (!ptr)
+			return;
+		AllocationHeader* header = static_cast<AllocationHeader*>(ptr) - 1;
+		currentBytes -= header->size;
+		std::free(header);
+	}
+}
+
+void* operator new(size_t size)
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	countedFree(ptr);
+}
+
+int main(int argc, char** argv)
+{
+	int size = argc > 1 ? std::atoi(argv[1]) : 1000;
+	std::vector<VertexKey> keys;
+	keys.reserve(static_cast<size_t>(size) * size * 6);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			uint32_t a = y * (size + 1) + x;
+			uint32_t b = a + 1;
+			uint32_t c = a + size + 1;
+			uint32_t d = c + 1;
+			uint32_t tri[6] = { a, b, d, a, d, c };
+			for (uint32_t v : tri)
+				keys.push_back(VertexKey{ v, v, v, 7 });
+		}
+	}
+	size_t faces = keys.size() / 3;
+	std::vector<Index> indices(keys.size());
+
+	auto flat = [faces](const std::vector<VertexKey>& in, std::vector<Index>& out) -> size_t
+	{
+		VertexHashTable table;
+		table.reserve(faces / 2);	//pre-sized from the face count like the loader
+		Index count = 0;
+		for (size_t i = 0; i < in.size(); i++)
+		{
+			out[i] = table.findOrInsert(in[i], count);
+			if (out[i] == count)
+				count++;
+		}
+		return count;
+	};
+	auto node = [](const std::vector<VertexKey>& in, std::vector<Index>& out) -> size_t
+	{
+		std::unordered_map<VertexKey, Index, VertexKeyHash> map;
+		for (size_t i = 0; i < in.size(); i++)
+		{
+			auto inserted = map.insert(std::make_pair(in[i], static_cast<Index>(map.size())));
+			out[i] = inserted.first->second;
+		}
+		return map.size();
+	};
+
+	for (int order = 0; order < 2; order++)
+	{
+		if (order == 1)
+		{
+			//shuffle whole triangles: no locality between neighbouring faces
+			std::vector<size_t> perm(faces);
+			for (size_t f = 0; f < faces; f++)
+				perm[f] = f;
+			std::shuffle(perm.begin(), perm.end(), std::mt19937(1));
+			std::vector<VertexKey> shuffled(keys.size());
+			for (size_t f = 0; f < faces; f++)
+				std::copy(keys.begin() + perm[f] * 3, keys.begin() + perm[f] * 3 + 3, shuffled.begin() + f * 3);
+			keys.swap(shuffled);
+		}
+		size_t uniqueflat = 0, uniquenode = 0, peakflat = 0, peaknode = 0;
+		double tflat = BenchmarkUtils::bestOf(3, [&]() { uniqueflat = run(keys, indices, peakflat, flat); });
+		double tnode = BenchmarkUtils::bestOf(3, [&]() { uniquenode = run(keys, indices, peaknode, node); });
+		double mrefs = keys.size() / 1e6;
+		std::printf("%zu faces, %zu unique vertices, %s order\n", faces, uniqueflat, order ? "shuffled" : "file");
+		std::printf("  std::unordered_map  %8.1f ms %8.1f M refs/s  peak %7.1f MB\n", tnode, mrefs / tnode * 1000.0, peaknode / 1048576.0);
+		std::printf("  VertexHashTable     %8.1f ms %8.1f M refs/s  peak %7.1f MB  %.1fx\n", tflat, mrefs / tflat * 1000.0, peakflat / 1048576.0, tnode / tflat);
+		if (uniqueflat != uniquenode)
+		{
+			std::printf("  unique vertex counts differ\n");
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -8,6 +8,7 @@ struct VertexAttribute
 	GLenum type;
 	GLsizei stride;
 	GLintptr offset;
+	GLboolean normalized;	//integer types only: fetched as [0, 1] (unsigned) or [-1, 1] (signed)
 };
 
 struct Vertex
@@ -18,6 +19,22 @@ struct Vertex
 	glm::vec3 tangent;
 };
 
+//16 byte alternative to Vertex, created by VertexQuantizer
+struct PackedVertex
+{
+	GLushort position[3];	//unorm16 within the bounding box of the mesh
+	GLshort normal[2];		//octahedral snorm16
+	GLbyte tangent[2];		//octahedral snorm8
+	GLushort uv[2];			//half float
+};
+
+//joint influences of a skinned vertex, kept as a second vertex stream next to Vertex / PackedVertex
+struct VertexSkin
+{
+	GLubyte joints[4];		//palette indices
+	GLubyte weights[4];		//unorm8, sum up to 255 (Skinning::packInfluences)
+};
+
 typedef GLuint Index;
 
 #endif
\ No newline at end of file
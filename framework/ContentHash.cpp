@@ -0,0 +1,70 @@
+#include "ContentHash.h"
+#include <cstring>
+
+namespace
+{
+	inline uint64_t rotl(uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+}
+
+ContentHash::ContentHash()
+{
+}
+
+ContentHash::~ContentHash()
+{
+}
+
+uint64_t ContentHash::hash(const char * data, size_t size)
+{
+	//xxhash64 style: four independent lanes over 32 byte blocks, then the tail
+	const uint64_t P1 = 0x9E3779B185EBCA87ull;
+	const uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t P3 = 0x165667B19E3779F9ull;
+	const uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+	const uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+	const char* c = data;
+	const char* end = data + size;
+	uint64_t h;
+
+	if (size >= 32)
+	{
+		uint64_t v[4] = { P1 + P2, P2, 0, 0 - P1 };
+		for (; end - c >= 32; c += 32)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				uint64_t w;
+				std::memcpy(&w, c + i * 8, 8);
+				v[i] = rotl(v[i] + w * P2, 31) * P1;
+			}
+		}
+		h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+		for (int i = 0; i < 4; i++)
+			h = (h ^ (rotl(v[i] * P2, 31) * P1)) * P1 + P4;
+	}
+	else
+	{
+		h = P5;
+	}
+	h += static_cast<uint64_t>(size);
+
+	for (; end - c >= 8; c += 8)
+	{
+		uint64_t w;
+		std::memcpy(&w, c, 8);
+		h = rotl(h ^ (rotl(w * P2, 31) * P1), 27) * P1 + P4;
+	}
+	for (; c != end; ++c)
+		h = rotl(h ^ (static_cast<uint8_t>(*c) * P5), 11) * P1;
+
+	h ^= h >> 33;
+	h *= P2;
+	h ^= h >> 29;
+	h *= P3;
+	h ^= h >> 32;
+	return h;
+}
@@ -0,0 +1,17 @@
+#ifndef _CONTENT_HASH_H_
+#define _CONTENT_HASH_H_
+#include <cstdint>
+#include <cstddef>
+
+//fast non cryptographic 64 bit content hash, shared by the mesh and shader binary caches
+class ContentHash
+{
+private:
+	ContentHash();
+	~ContentHash();
+
+public:
+	static uint64_t hash(const char* data, size_t size);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	m_data(nullptr),
+	m_size(0),
+	m_open(false),
+#ifdef _WIN32
+	m_file(nullptr),
+	m_mapping(nullptr)
+#else
+	m_fd(-1)
+#endif
+{}
+
+MappedFile::MappedFile(const std::string & path) :
+	MappedFile()
+{
+	open(path);
+}
+
+MappedFile::MappedFile(MappedFile && other) :
+	m_data(other.m_data),
+	m_size(other.m_size),
+	m_open(other.m_open),
+#ifdef _WIN32
+	m_file(other.m_file),
+	m_mapping(other.m_mapping)
+#else
+	m_fd(other.m_fd)
+#endif
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_open = false;
+#ifdef _WIN32
+	other.m_file = nullptr;
+	other.m_mapping = nullptr;
+#else
+	other.m_fd = -1;
+#endif
+}
+
+MappedFile & MappedFile::operator=(MappedFile && other)
+{
+	if (this == &other)
+		return *this;
+
+	close();
+	m_data = other.m_data;
+	m_size = other.m_size;
+	m_open = other.m_open;
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_open = false;
+#ifdef _WIN32
+	m_file = other.m_file;
+	m_mapping = other.m_mapping;
+	other.m_file = nullptr;
+	other.m_mapping = nullptr;
+#else
+	m_fd = other.m_fd;
+	other.m_fd = -1;
+#endif
+
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+void MappedFile::open(const std::string & path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::logic_error("File not found.");
+	LARGE_INTEGER fsize;
+	if (!GetFileSizeEx(file, &fsize))
+	{
+		CloseHandle(file);
+		throw std::logic_error("Could not determine file size.");
+	}
+	m_file = file;
+	m_size = static_cast<size_t>(fsize.QuadPart);
+	m_open = true;
+	if (m_size == 0) //empty files can't be mapped
+		return;
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		close();
+		throw std::logic_error("Could not map file.");
+	}
+	m_mapping = mapping;
+	m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr)
+	{
+		close();
+		throw std::logic_error("Could not map file.");
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		throw std::logic_error("File not found.");
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		throw std::logic_error("Could not determine file size.");
+	}
+	m_fd = fd;
+	m_size = static_cast<size_t>(st.st_size);
+	m_open = true;
+	if (m_size == 0) //empty files can't be mapped
+		return;
+	void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED)
+	{
+		close();
+		throw std::logic_error("Could not map file.");
+	}
+	m_data = static_cast<const char*>(addr);
+	madvise(addr, m_size, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(static_cast<HANDLE>(m_mapping));
+	if (m_file)
+		CloseHandle(static_cast<HANDLE>(m_file));
+	m_file = nullptr;
+	m_mapping = nullptr;
+#else
+	if (m_data)
+		munmap(const_cast<char*>(m_data), m_size);
+	if (m_fd != -1)
+		::close(m_fd);
+	m_fd = -1;
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
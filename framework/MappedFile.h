@@ -0,0 +1,51 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+#include <string>
+#include <cstddef>
+#include <stdexcept>
+
+//read only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile();
+	MappedFile(const std::string& path);
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+	MappedFile(MappedFile&& other);
+	MappedFile& operator=(MappedFile&& other);
+	~MappedFile();
+
+	//throws std::logic_error if the file can't be opened or mapped
+	void open(const std::string& path);
+	void close();
+
+	bool isOpen() const
+	{
+		return m_open;
+	}
+
+	//nullptr for empty files
+	const char* data() const
+	{
+		return m_data;
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	const char* m_data;
+	size_t m_size;
+	bool m_open;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_fd;
+#endif
+};
+
+#endif
@@ -0,0 +1,424 @@
+#include "MeshCache.h"
+#include <MappedFile.h>
+#include <ContentHash.h>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace
+{
+	const char MAGIC[8] = { 'V', 'C', 'M', 'E', 'S', 'H', '\0', '\0' };
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t flags;
+		uint32_t vertexsize;
+		uint32_t indexsize;
+		uint64_t srcsize;
+		int64_t srcmtime;
+		uint64_t srchash;
+		uint32_t objectcount;
+		uint32_t reserved;
+	};
+
+	//smallest records on disk, used to reject counts the file can't hold before allocating
+	const size_t MIN_OBJECT_SIZE = 2 * sizeof(uint32_t);					//name length, mesh count
+	const size_t MIN_MESH_SIZE = 5 * sizeof(uint32_t) + 3 * sizeof(uint64_t);	//name length, flags, attribute count, vertex and index counts
+
+	//bounds checked reads from the mapped cache file
+	class Reader
+	{
+	public:
+		Reader(const char* data, size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+		bool read(void* out, size_t size)
+		{
+			if (size > m_size - m_pos)
+				return false;
+			std::memcpy(out, m_data + m_pos, size);
+			m_pos += size;
+			return true;
+		}
+
+		template <typename T>
+		bool read(T& out)
+		{
+			return read(&out, sizeof(T));
+		}
+
+		bool readString(std::string& out)
+		{
+			uint32_t len;
+			if (!read(len) || len > m_size - m_pos)
+				return false;
+			out.assign(m_data + m_pos, len);
+			m_pos += len;
+			return true;
+		}
+
+		bool align(size_t alignment)
+		{
+			size_t aligned = (m_pos + alignment - 1) / alignment * alignment;
+			if (aligned > m_size)
+				return false;
+			m_pos = aligned;
+			return true;
+		}
+
+		size_t remaining() const
+		{
+			return m_size - m_pos;
+		}
+
+		//returns the next size bytes without copying them
+		const char* skip(size_t size)
+		{
+			if (size > m_size - m_pos)
+				return nullptr;
+			const char* data = m_data + m_pos;
+			m_pos += size;
+			return data;
+		}
+
+	private:
+		const char* m_data;
+		size_t m_size;
+		size_t m_pos;
+	};
+
+	class Writer
+	{
+	public:
+		Writer(std::ofstream& stream) : m_stream(stream), m_pos(0) {}
+
+		void write(const void* data, size_t size)
+		{
+			m_stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			m_pos += size;
+		}
+
+		template <typename T>
+		void write(const T& value)
+		{
+			write(&value, sizeof(T));
+		}
+
+		void writeString(const std::string& str)
+		{
+			write(static_cast<uint32_t>(str.size()));
+			write(str.data(), str.size());
+		}
+
+		void align(size_t alignment)
+		{
+			static const char zeros[16] = {};
+			size_t aligned = (m_pos + alignment - 1) / alignment * alignment;
+			write(zeros, aligned - m_pos);
+		}
+
+	private:
+		std::ofstream& m_stream;
+		size_t m_pos;
+	};
+}
+
+bool MeshCache::read(const std::string & cachepath, const std::string & srcpath, uint32_t flags, OBJResult & result)
+{
+	try
+	{
+		uint64_t srcsize, cachesize;
+		int64_t srcmtime, cachemtime;
+		if (!getFileInfo(srcpath, srcsize, srcmtime) || !getFileInfo(cachepath, cachesize, cachemtime))
+			return false;
+
+		MappedFile file(cachepath);
+		Reader reader(file.data(), file.size());
+
+		Header header;
+		if (!reader.read(header) ||
+			std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+			header.version != VERSION ||
+			header.flags != flags ||
+			header.vertexsize != sizeof(Vertex) ||
+			header.indexsize != sizeof(Index) ||
+			header.srcsize != srcsize)
+			return false;
+
+		bool touched = header.srcmtime != srcmtime;
+		if (touched)
+		{
+			//touched but maybe not changed (i.e. fresh checkout). Compare content.
+			MappedFile src(srcpath);
+			if (ContentHash::hash(src.data(), src.size()) != header.srchash)
+				return false;
+		}
+
+		OBJResult tmp;
+		if (header.objectcount > reader.remaining() / MIN_OBJECT_SIZE)
+			return false;
+		tmp.objects.resize(header.objectcount);
+		for (auto& object : tmp.objects)
+		{
+			uint32_t meshcount;
+			if (!reader.readString(object.name) || !reader.read(meshcount) || meshcount > reader.remaining() / MIN_MESH_SIZE)
+				return false;
+			object.meshes.resize(meshcount);
+			for (auto& mesh : object.meshes)
+			{
+				uint8_t has[4];
+				uint32_t attcount;
+				if (!reader.readString(mesh.name) || !reader.read(has) || !reader.read(attcount))
+					return false;
+				mesh.hasPositions = has[0] != 0;
+				mesh.hasUVs = has[1] != 0;
+				mesh.hasNormals = has[2] != 0;
+				mesh.hasTangents = has[3] != 0;
+				for (uint32_t i = 0; i < attcount; i++)
+				{
+					int32_t n, stride;
+					uint32_t type;
+					int64_t offset;
+					if (!reader.read(n) || !reader.read(type) || !reader.read(stride) || !reader.read(offset))
+						return false;
+					mesh.atts.push_back(VertexAttribute{ n, type, stride, static_cast<GLintptr>(offset), GL_FALSE });
+				}
+				uint64_t vertexcount, indexcount, indexbytes;
+				uint32_t indextype, encoding;
+				if (!reader.read(vertexcount) || !reader.read(indexcount) ||
+					!reader.read(indextype) || !reader.read(encoding) || !reader.read(indexbytes) ||
+					!reader.align(8) || vertexcount > reader.remaining() / sizeof(Vertex))
+					return false;
+				mesh.vertices.resize(static_cast<size_t>(vertexcount));
+				reader.read(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+				mesh.indexType = OBJLoader::selectIndexType(mesh.vertices.size());
+				const char* indexdata;
+				if (indextype != mesh.indexType || !reader.align(8) ||
+					indexbytes > reader.remaining() || !(indexdata = reader.skip(static_cast<size_t>(indexbytes))))
+					return false;
+				if (encoding == DeltaVarintIndices)
+				{
+					//every index takes at least one byte
+					if (indexcount > indexbytes)
+						return false;
+					mesh.indices.reserve(static_cast<size_t>(indexcount));
+					if (!decodeIndices(reinterpret_cast<const uint8_t*>(indexdata), static_cast<size_t>(indexbytes), mesh.vertices.size(), mesh.indices) ||
+						mesh.indices.size() != indexcount)
+						return false;
+				}
+				else if (encoding == RawIndices && indextype == GL_UNSIGNED_SHORT)
+				{
+					if (indexbytes != indexcount * sizeof(GLushort))
+						return false;
+					mesh.indices.resize(static_cast<size_t>(indexcount));
+					for (size_t i = 0; i < mesh.indices.size(); i++)
+					{
+						GLushort idx;
+						std::memcpy(&idx, indexdata + i * sizeof(GLushort), sizeof(GLushort));
+						if (idx >= mesh.vertices.size())
+							return false;
+						mesh.indices[i] = idx;
+					}
+				}
+				else if (encoding == RawIndices && indextype == GL_UNSIGNED_INT)
+				{
+					if (indexbytes != indexcount * sizeof(Index))
+						return false;
+					mesh.indices.resize(static_cast<size_t>(indexcount));
+					std::memcpy(mesh.indices.data(), indexdata, static_cast<size_t>(indexbytes));
+					for (Index idx : mesh.indices)
+					{
+						if (idx >= mesh.vertices.size())
+							return false;
+					}
+				}
+				else
+				{
+					return false;
+				}
+			}
+		}
+		result = std::move(tmp);
+
+		if (touched)
+		{
+			//remember the new mtime so the next start doesn't need to hash again
+			file.close();
+			std::fstream stream(cachepath, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+			stream.seekp(offsetof(Header, srcmtime));
+			stream.write(reinterpret_cast<const char*>(&srcmtime), sizeof(srcmtime));
+		}
+		return true;
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
+
+void MeshCache::write(const std::string & cachepath, const std::string & srcpath, uint32_t flags, const OBJResult & result, bool compressindices)
+{
+	Header header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.flags = flags;
+	header.vertexsize = sizeof(Vertex);
+	header.indexsize = sizeof(Index);
+	header.objectcount = static_cast<uint32_t>(result.objects.size());
+	header.reserved = 0;
+	for (const auto& object : result.objects)
+	{
+		for (const auto& mesh : object.meshes)
+		{
+			if (mesh.packed)
+				throw std::logic_error("Packed meshes can't be cached.");
+		}
+	}
+	{
+		MappedFile src(srcpath);
+		header.srchash = ContentHash::hash(src.data(), src.size());
+	}
+	if (!getFileInfo(srcpath, header.srcsize, header.srcmtime))
+		throw std::logic_error("Source file not found.");
+
+	//write to a temporary file first, so an interrupted write never leaves a valid looking cache behind
+	std::string tmppath = cachepath + ".tmp";
+	{
+		std::ofstream stream(tmppath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		if (!stream.is_open())
+			throw std::logic_error("Could not create mesh cache file.");
+		Writer writer(stream);
+		writer.write(header);
+		std::vector<uint8_t> indexdata;
+		for (const auto& object : result.objects)
+		{
+			writer.writeString(object.name);
+			writer.write(static_cast<uint32_t>(object.meshes.size()));
+			for (const auto& mesh : object.meshes)
+			{
+				uint8_t has[4] = {
+					static_cast<uint8_t>(mesh.hasPositions),
+					static_cast<uint8_t>(mesh.hasUVs),
+					static_cast<uint8_t>(mesh.hasNormals),
+					static_cast<uint8_t>(mesh.hasTangents)
+				};
+				writer.writeString(mesh.name);
+				writer.write(has);
+				writer.write(static_cast<uint32_t>(mesh.atts.size()));
+				for (const auto& att : mesh.atts)
+				{
+					writer.write(static_cast<int32_t>(att.n));
+					writer.write(static_cast<uint32_t>(att.type));
+					writer.write(static_cast<int32_t>(att.stride));
+					writer.write(static_cast<int64_t>(att.offset));
+				}
+				//the type is derived from the vertex count again when reading
+				GLenum indextype = OBJLoader::selectIndexType(mesh.vertices.size());
+				if (compressindices)
+				{
+					encodeIndices(mesh.indices, indexdata);
+				}
+				else if (indextype == GL_UNSIGNED_SHORT)
+				{
+					indexdata.resize(mesh.indices.size() * sizeof(GLushort));
+					for (size_t i = 0; i < mesh.indices.size(); i++)
+					{
+						GLushort idx = static_cast<GLushort>(mesh.indices[i]);
+						std::memcpy(&indexdata[i * sizeof(GLushort)], &idx, sizeof(GLushort));
+					}
+				}
+				else
+				{
+					indexdata.resize(mesh.indices.size() * sizeof(Index));
+					std::memcpy(indexdata.data(), mesh.indices.data(), indexdata.size());
+				}
+				writer.write(static_cast<uint64_t>(mesh.vertices.size()));
+				writer.write(static_cast<uint64_t>(mesh.indices.size()));
+				writer.write(static_cast<uint32_t>(indextype));
+				writer.write(static_cast<uint32_t>(compressindices ? DeltaVarintIndices : RawIndices));
+				writer.write(static_cast<uint64_t>(indexdata.size()));
+				writer.align(8);
+				writer.write(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+				writer.align(8);
+				writer.write(indexdata.data(), indexdata.size());
+			}
+		}
+		if (!stream)
+		{
+			stream.close();
+			std::remove(tmppath.c_str());
+			throw std::logic_error("Could not write mesh cache file.");
+		}
+	}
+	std::remove(cachepath.c_str());
+	if (std::rename(tmppath.c_str(), cachepath.c_str()) != 0)
+	{
+		std::remove(tmppath.c_str());
+		throw std::logic_error("Could not move mesh cache file into place.");
+	}
+}
+
+void MeshCache::encodeIndices(const std::vector<Index>& indices, std::vector<uint8_t>& out)
+{
+	out.clear();
+	out.reserve(indices.size() + indices.size() / 4);
+	Index prev = 0;
+	for (Index idx : indices)
+	{
+		//zigzag: small negative and positive differences both become small unsigned values
+		int32_t delta = static_cast<int32_t>(idx - prev);
+		uint32_t value = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+		prev = idx;
+	}
+}
+
+bool MeshCache::decodeIndices(const uint8_t * data, size_t size, size_t vertexcount, std::vector<Index>& indices)
+{
+	const uint8_t* end = data + size;
+	Index prev = 0;
+	while (data != end)
+	{
+		uint32_t value = 0;
+		int shift = 0;
+		uint8_t byte;
+		do
+		{
+			if (data == end || shift > 28)
+				return false;
+			byte = *data++;
+			value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+		Index idx = prev + ((value >> 1) ^ (0u - (value & 1u)));
+		if (idx >= vertexcount)
+			return false;
+		indices.push_back(idx);
+		prev = idx;
+	}
+	return true;
+}
+
+bool MeshCache::getFileInfo(const std::string & path, uint64_t & size, int64_t & mtime)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_stat64(path.c_str(), &st) != 0)
+		return false;
+#else
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return false;
+#endif
+	size = static_cast<uint64_t>(st.st_size);
+	mtime = static_cast<int64_t>(st.st_mtime);
+	return true;
+}
@@ -0,0 +1,60 @@
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+#include <OBJLoader.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Binary cache (.vcmesh) for loaded OBJ files.
+//Stores the already deduplicated vertices and indices of every mesh together with names and attribute layout.
+//The data is written in native byte order and Vertex layout, both are checked when the cache is read.
+//
+//Layout:
+//	header:	"VCMESH\0\0", version, flags, sizeof(Vertex), sizeof(Index),
+//			source size, source mtime, source content hash, object count
+//	object:	name, mesh count
+//	mesh:	name, has* flags, attributes, vertex count, index count, index type, index encoding, index data size,
+//			vertex data and index data, each aligned to 8 bytes
+//
+//Indices are stored with the width of OBJMesh::indexType, so most meshes need 2 bytes per index.
+//Optionally they are compressed: the difference to the previous index, zigzag mapped to unsigned and written
+//as LEB128 varint. After MeshOptimizer most differences are small and take 1 byte.
+class MeshCache
+{
+private:
+	MeshCache();
+	~MeshCache();
+
+public:
+	static const uint32_t VERSION = 2;
+
+	enum IndexEncoding : uint32_t
+	{
+		RawIndices = 0,
+		DeltaVarintIndices = 1
+	};
+
+	//flags describing the post processing baked into the cache
+	enum Flags : uint32_t
+	{
+		CalcNormals = 1u << 0,
+		CalcTangents = 1u << 1
+	};
+
+	//Reads the cache if it belongs to the current content of srcpath.
+	//The source is considered unchanged if size and mtime match or, if only the mtime differs, its content hash matches.
+	//Returns false if the cache is missing, stale or corrupt.
+	static bool read(const std::string& cachepath, const std::string& srcpath, uint32_t flags, OBJResult& result);
+
+	//Writes result to cachepath. Throws std::logic_error on failure or if a mesh was packed by VertexQuantizer.
+	//compressindices selects DeltaVarintIndices, read handles both encodings.
+	static void write(const std::string& cachepath, const std::string& srcpath, uint32_t flags, const OBJResult& result, bool compressindices = false);
+
+	//delta + zigzag + varint index encoding. decodeIndices returns false on truncated data or indices >= vertexcount.
+	static void encodeIndices(const std::vector<Index>& indices, std::vector<uint8_t>& out);
+	static bool decodeIndices(const uint8_t* data, size_t size, size_t vertexcount, std::vector<Index>& indices);
+
+	static bool getFileInfo(const std::string& path, uint64_t& size, int64_t& mtime);
+};
+
+#endif
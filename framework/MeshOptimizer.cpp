@@ -0,0 +1,411 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+const unsigned int MeshOptimizer::DEFAULT_CACHE_SIZE;
+
+namespace
+{
+	//Forsyth scoring parameters (LRU cache model)
+	const int MAX_CACHE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRI_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+	const size_t VALENCE_TABLE_SIZE = 64;
+
+	const Index NO_INDEX = 0xFFFFFFFFu;
+
+	class ScoreTables
+	{
+	public:
+		float cache[MAX_CACHE];
+		float valence[VALENCE_TABLE_SIZE];
+
+		ScoreTables()
+		{
+			for (int i = 0; i < MAX_CACHE; i++)
+			{
+				//the vertices of the last triangle get a fixed score so the same triangle isn't favored twice
+				if (i < 3)
+					cache[i] = LAST_TRI_SCORE;
+				else
+					cache[i] = std::pow(1.0f - static_cast<float>(i - 3) / static_cast<float>(MAX_CACHE - 3), CACHE_DECAY_POWER);
+			}
+			valence[0] = 0.0f;
+			for (size_t i = 1; i < VALENCE_TABLE_SIZE; i++)
+				valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+		}
+
+		//cachepos -1: not in cache
+		float vertexScore(int cachepos, size_t remaining) const
+		{
+			if (remaining == 0)
+				return -1.0f;
+			float score = cachepos >= 0 ? cache[cachepos] : 0.0f;
+			//vertices with few triangles left are boosted to get rid of lone triangles
+			if (remaining < VALENCE_TABLE_SIZE)
+				return score + valence[remaining];
+			return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+		}
+	};
+
+	//FIFO cache simulated with timestamps: a vertex is cached if it missed within the last cachesize misses
+	class FIFOCache
+	{
+	public:
+		FIFOCache(size_t vertexcount, unsigned int cachesize) :
+			m_stamps(vertexcount, 0),
+			m_size(cachesize),
+			m_time(cachesize + 1)
+		{}
+
+		void reset()
+		{
+			m_time += m_size + 1;
+		}
+
+		//number of misses of the triangle
+		unsigned int add(const Index* triangle)
+		{
+			unsigned int misses = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				if (m_time - m_stamps[triangle[i]] > m_size)
+				{
+					m_stamps[triangle[i]] = m_time++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+	private:
+		std::vector<uint64_t> m_stamps;
+		uint64_t m_size;
+		uint64_t m_time;
+	};
+}
+
+void MeshOptimizer::optimize(OBJMesh & mesh, Stats * before, Stats * after, float overdrawthreshold)
+{
+	if (mesh.packed)
+		throw std::logic_error("Mesh optimization needs the float vertices, run it before quantization.");
+	try
+	{
+		if (before)
+			*before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+		optimizeVertexCache(mesh.indices, mesh.vertices.size());
+		optimizeOverdraw(mesh.indices, mesh.vertices, overdrawthreshold);
+		optimizeVertexFetch(mesh);
+		if (after)
+			*after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+void MeshOptimizer::optimize(OBJResult & result, bool log, float overdrawthreshold)
+{
+	for (auto& object : result.objects)
+	{
+		for (auto& mesh : object.meshes)
+		{
+			Stats before, after;
+			optimize(mesh, &before, &after, overdrawthreshold);
+			if (log)
+				printStats(std::cout, object.name + "/" + mesh.name, before, after);
+		}
+	}
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<Index>& indices, size_t vertexcount)
+{
+	try
+	{
+		size_t ntris = indices.size() / 3;
+		if (ntris == 0)
+			return;
+		static const ScoreTables tables;
+
+		//triangles per vertex. Only the first "remaining" entries of each range are still to be emitted.
+		std::vector<Index> offsets(vertexcount + 1, 0);
+		for (size_t i = 0; i < ntris * 3; i++)
+		{
+			if (indices[i] >= vertexcount)
+				throw std::logic_error("Index out of range.");
+			offsets[indices[i] + 1]++;
+		}
+		std::vector<Index> remaining(vertexcount);
+		for (size_t v = 0; v < vertexcount; v++)
+		{
+			remaining[v] = offsets[v + 1];
+			offsets[v + 1] += offsets[v];
+		}
+		std::vector<Index> adjacency(ntris * 3);
+		{
+			std::vector<Index> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < ntris * 3; i++)
+				adjacency[fill[indices[i]]++] = static_cast<Index>(i / 3);
+		}
+
+		std::vector<float> vscore(vertexcount);
+		for (size_t v = 0; v < vertexcount; v++)
+			vscore[v] = tables.vertexScore(-1, remaining[v]);
+		std::vector<bool> emitted(ntris, false);
+		Index best = 0;
+		float bestscore = -1.0f;
+		for (size_t t = 0; t < ntris; t++)
+		{
+			float score = vscore[indices[t * 3]] + vscore[indices[t * 3 + 1]] + vscore[indices[t * 3 + 2]];
+			if (score > bestscore)
+			{
+				bestscore = score;
+				best = static_cast<Index>(t);
+			}
+		}
+
+		std::vector<Index> result;
+		result.reserve(ntris * 3);
+		std::vector<Index> cache, newcache;
+		cache.reserve(MAX_CACHE + 3);
+		newcache.reserve(MAX_CACHE + 3);
+		size_t scan = 0;	//all triangles before scan are emitted
+
+		for (size_t n = 0; n < ntris; n++)
+		{
+			if (best == NO_INDEX)
+			{
+				//nothing in the cache has triangles left, continue with the next unemitted one
+				while (emitted[scan])
+					scan++;
+				best = static_cast<Index>(scan);
+			}
+
+			const Index* tri = &indices[best * 3];
+			result.insert(result.end(), tri, tri + 3);
+			emitted[best] = true;
+
+			//remove the triangle from the lists of its vertices
+			for (int i = 0; i < 3; i++)
+			{
+				Index v = tri[i];
+				Index* list = &adjacency[offsets[v]];
+				for (Index k = 0; k < remaining[v]; k++)
+				{
+					if (list[k] == best)
+					{
+						std::swap(list[k], list[remaining[v] - 1]);
+						remaining[v]--;
+						break;
+					}
+				}
+			}
+
+			//LRU: the triangle's vertices move to the front
+			newcache.clear();
+			for (int i = 0; i < 3; i++)
+			{
+				if (std::find(newcache.begin(), newcache.end(), tri[i]) == newcache.end())
+					newcache.push_back(tri[i]);
+			}
+			for (Index v : cache)
+			{
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					newcache.push_back(v);
+			}
+			for (size_t i = MAX_CACHE; i < newcache.size(); i++)
+				vscore[newcache[i]] = tables.vertexScore(-1, remaining[newcache[i]]);
+			if (newcache.size() > static_cast<size_t>(MAX_CACHE))
+				newcache.resize(MAX_CACHE);
+			for (size_t i = 0; i < newcache.size(); i++)
+				vscore[newcache[i]] = tables.vertexScore(static_cast<int>(i), remaining[newcache[i]]);
+			cache.swap(newcache);
+
+			//rescore the triangles around the cached vertices and pick the best one
+			best = NO_INDEX;
+			bestscore = -1.0f;
+			for (Index v : cache)
+			{
+				const Index* list = &adjacency[offsets[v]];
+				for (Index k = 0; k < remaining[v]; k++)
+				{
+					Index t = list[k];
+					float score = vscore[indices[t * 3]] + vscore[indices[t * 3 + 1]] + vscore[indices[t * 3 + 2]];
+					if (score > bestscore)
+					{
+						bestscore = score;
+						best = t;
+					}
+				}
+			}
+		}
+		indices.swap(result);
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<Index>& indices, const std::vector<Vertex>& vertices, float threshold, unsigned int cachesize)
+{
+	try
+	{
+		size_t ntris = indices.size() / 3;
+		if (ntris == 0)
+			return;
+		FIFOCache cache(vertices.size(), cachesize);
+
+		//hard boundaries: a triangle without a cached vertex usually starts a new patch of the mesh
+		std::vector<size_t> hard;
+		for (size_t t = 0; t < ntris; t++)
+		{
+			if (cache.add(&indices[t * 3]) == 3 || t == 0)
+				hard.push_back(t);
+		}
+		hard.push_back(ntris);
+
+		//soft boundaries: split a patch wherever its running ACMR is already within threshold of the whole patch
+		std::vector<size_t> clusters;
+		for (size_t c = 0; c + 1 < hard.size(); c++)
+		{
+			size_t start = hard[c];
+			size_t end = hard[c + 1];
+			cache.reset();
+			size_t misses = 0;
+			for (size_t t = start; t < end; t++)
+				misses += cache.add(&indices[t * 3]);
+			float clusterthreshold = threshold * static_cast<float>(misses) / static_cast<float>(end - start);
+
+			clusters.push_back(start);
+			cache.reset();
+			size_t runningmisses = 0, runningtris = 0;
+			for (size_t t = start; t < end; t++)
+			{
+				runningmisses += cache.add(&indices[t * 3]);
+				runningtris++;
+				if (static_cast<float>(runningmisses) / static_cast<float>(runningtris) <= clusterthreshold && t + 1 < end)
+				{
+					clusters.push_back(t + 1);
+					cache.reset();
+					runningmisses = 0;
+					runningtris = 0;
+				}
+			}
+			//the rest didn't reach the target, merge it into the previous cluster
+			if (runningtris > 0 && clusters.back() != start)
+				clusters.pop_back();
+		}
+		clusters.push_back(ntris);
+
+		//sort clusters by how much they face away from the mesh center: those get drawn first and occlude the rest
+		glm::vec3 meshcenter(0.0f);
+		for (size_t i = 0; i < ntris * 3; i++)
+			meshcenter += vertices[indices[i]].position;
+		meshcenter /= static_cast<float>(ntris * 3);
+
+		size_t nclusters = clusters.size() - 1;
+		std::vector<float> sortkeys(nclusters);
+		for (size_t c = 0; c < nclusters; c++)
+		{
+			glm::vec3 center(0.0f);
+			glm::vec3 normal(0.0f);
+			float area = 0.0f;
+			for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+			{
+				const glm::vec3& v1 = vertices[indices[t * 3]].position;
+				const glm::vec3& v2 = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& v3 = vertices[indices[t * 3 + 2]].position;
+				glm::vec3 n = glm::cross(v2 - v1, v3 - v1);
+				float a = glm::length(n);
+				center += (v1 + v2 + v3) * (a / 3.0f);
+				normal += n;
+				area += a;
+			}
+			float nlength = glm::length(normal);
+			if (area > 0.0f && nlength > 0.0f)
+				sortkeys[c] = glm::dot(center / area - meshcenter, normal / nlength);
+			else
+				sortkeys[c] = 0.0f;
+		}
+		std::vector<size_t> order(nclusters);
+		for (size_t c = 0; c < nclusters; c++)
+			order[c] = c;
+		std::stable_sort(order.begin(), order.end(), [&sortkeys](size_t a, size_t b)
+		{
+			return sortkeys[a] > sortkeys[b];
+		});
+
+		std::vector<Index> result;
+		result.reserve(ntris * 3);
+		for (size_t c : order)
+			result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+		indices.swap(result);
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+void MeshOptimizer::optimizeVertexFetch(OBJMesh & mesh)
+{
+	if (mesh.packed)
+		throw std::logic_error("Mesh optimization needs the float vertices, run it before quantization.");
+	try
+	{
+		std::vector<Index> remap(mesh.vertices.size(), NO_INDEX);
+		std::vector<Vertex> vertices;
+		vertices.reserve(mesh.vertices.size());
+		for (auto& idx : mesh.indices)
+		{
+			if (remap[idx] == NO_INDEX)
+			{
+				remap[idx] = static_cast<Index>(vertices.size());
+				vertices.push_back(mesh.vertices[idx]);
+			}
+			idx = remap[idx];
+		}
+		mesh.vertices.swap(vertices);
+		mesh.indexType = OBJLoader::selectIndexType(mesh.vertices.size());
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+MeshOptimizer::Stats MeshOptimizer::analyzeVertexCache(const std::vector<Index>& indices, size_t vertexcount, unsigned int cachesize)
+{
+	Stats stats;
+	stats.triangles = indices.size() / 3;
+	FIFOCache cache(vertexcount, cachesize);
+	std::vector<bool> used(vertexcount, false);
+	for (size_t t = 0; t < stats.triangles; t++)
+	{
+		stats.misses += cache.add(&indices[t * 3]);
+		for (int i = 0; i < 3; i++)
+		{
+			if (!used[indices[t * 3 + i]])
+			{
+				used[indices[t * 3 + i]] = true;
+				stats.vertices++;
+			}
+		}
+	}
+	if (stats.triangles > 0)
+		stats.acmr = static_cast<float>(stats.misses) / static_cast<float>(stats.triangles);
+	if (stats.vertices > 0)
+		stats.atvr = static_cast<float>(stats.misses) / static_cast<float>(stats.vertices);
+	return stats;
+}
+
+void MeshOptimizer::printStats(std::ostream & stream, const std::string & name, const Stats & before, const Stats & after)
+{
+	stream << name << ": " << after.triangles << " triangles, " << after.vertices << " vertices, ACMR "
+		<< before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+}
@@ -0,0 +1,48 @@
+#ifndef _MESH_OPTIMIZER_H_
+#define _MESH_OPTIMIZER_H_
+#include <OBJLoader.h>
+#include <vector>
+#include <string>
+#include <iostream>
+
+//Optional post load pass that reorders OBJMesh data for the GPU. Run it after loading and before
+//VertexQuantizer and upload; packed meshes are rejected with a std::logic_error.
+//	1. vertex cache: triangle order for post transform cache reuse (Forsyth, linear speed vertex cache optimisation)
+//	2. overdraw: the cache optimized order is split into clusters that are sorted front to back, outward facing first (Tipsify)
+//	3. vertex fetch: vertices are renumbered in order of first use, unreferenced ones are removed
+class MeshOptimizer
+{
+private:
+	MeshOptimizer();
+	~MeshOptimizer();
+
+public:
+	//size of the simulated FIFO cache used for the statistics and the overdraw clusters
+	static const unsigned int DEFAULT_CACHE_SIZE = 16;
+
+	class Stats
+	{
+	public:
+		size_t triangles = 0;
+		size_t vertices = 0;	//referenced vertices
+		size_t misses = 0;		//transformed vertices
+		float acmr = 0.0f;		//average cache miss ratio: misses per triangle. 0.5 is ideal for large grids, 3 is worst
+		float atvr = 0.0f;		//average transformed vertex ratio: misses per vertex. 1 is ideal
+	};
+
+	//all three passes. before and after receive the statistics if not null.
+	//overdrawthreshold: how much the cache efficiency may suffer for overdraw sorting (1: not at all)
+	static void optimize(OBJMesh& mesh, Stats* before = nullptr, Stats* after = nullptr, float overdrawthreshold = 1.05f);
+	//optimizes all meshes. If log is set, the statistics of every mesh are printed to std::cout.
+	static void optimize(OBJResult& result, bool log = false, float overdrawthreshold = 1.05f);
+
+	static void optimizeVertexCache(std::vector<Index>& indices, size_t vertexcount);
+	static void optimizeOverdraw(std::vector<Index>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f, unsigned int cachesize = DEFAULT_CACHE_SIZE);
+	static void optimizeVertexFetch(OBJMesh& mesh);
+
+	//simulates a FIFO post transform cache
+	static Stats analyzeVertexCache(const std::vector<Index>& indices, size_t vertexcount, unsigned int cachesize = DEFAULT_CACHE_SIZE);
+	static void printStats(std::ostream& stream, const std::string& name, const Stats& before, const Stats& after);
+};
+
+#endif
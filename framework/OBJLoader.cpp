@@ -1,4 +1,13 @@
 #include "OBJLoader.h"
+#include <MappedFile.h>
+#include <MeshCache.h>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 
 
@@ -47,6 +56,314 @@ OBJResult OBJLoader::loadOBJ(const std::string & objpath, bool calcnormals, bool
 	}
 }
 
+OBJResult OBJLoader::loadOBJMapped(const std::string & objpath, bool calcnormals, bool calctangents, unsigned int threads)
+{
+	OBJResult result;
+	try
+	{
+		MappedFile file;
+		try
+		{
+			file.open(objpath);
+		}
+		catch (const std::exception&)
+		{
+			throw std::logic_error("OBJ file not found.");
+		}
+		const char* begin = file.data();
+		const char* end = file.data() + file.size();
+
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		//don't bother spawning threads for small files
+		size_t nchunks = std::min(static_cast<size_t>(threads), file.size() / (1u << 20) + 1);
+
+		//split at line boundaries
+		std::vector<const char*> bounds;
+		bounds.push_back(begin);
+		for (size_t i = 1; i < nchunks; i++)
+		{
+			const char* c = std::max(begin + file.size() * i / nchunks, bounds.back());
+			while (c != end && *c != '\n')
+				++c;
+			if (c != end)
+				++c;
+			bounds.push_back(c);
+		}
+		bounds.push_back(end);
+
+		//parse chunks
+		std::vector<Chunk> chunks(nchunks);
+		std::vector<std::exception_ptr> errors(nchunks);
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < nchunks; i++)
+		{
+			workers.push_back(std::thread([&chunks, &errors, &bounds, i]()
+			{
+				try
+				{
+					chunks[i] = scanChunk(bounds[i], bounds[i + 1]);
+				}
+				catch (...)
+				{
+					errors[i] = std::current_exception();
+				}
+			}));
+		}
+		try
+		{
+			chunks[0] = scanChunk(bounds[0], bounds[1]);
+		}
+		catch (...)
+		{
+			errors[0] = std::current_exception();
+		}
+		for (auto& worker : workers)
+			worker.join();
+		for (auto& error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+
+		//merge vertex data in file order, then rebuild objects and meshes
+		DataCache cache;
+		size_t npositions = 0, nuvs = 0, nnormals = 0;
+		for (const auto& chunk : chunks)
+		{
+			npositions += chunk.data.positions.size();
+			nuvs += chunk.data.uvs.size();
+			nnormals += chunk.data.normals.size();
+		}
+		cache.positions.reserve(npositions);
+		cache.uvs.reserve(nuvs);
+		cache.normals.reserve(nnormals);
+
+		AssemblyState state;
+		state.result = &result;
+		for (auto& chunk : chunks)
+		{
+			size_t pbase = cache.positions.size();
+			size_t uvbase = cache.uvs.size();
+			size_t nbase = cache.normals.size();
+			cache.positions.insert(cache.positions.end(), chunk.data.positions.begin(), chunk.data.positions.end());
+			cache.uvs.insert(cache.uvs.end(), chunk.data.uvs.begin(), chunk.data.uvs.end());
+			cache.normals.insert(cache.normals.end(), chunk.data.normals.begin(), chunk.data.normals.end());
+			assembleChunk(state, cache, chunk, pbase, uvbase, nbase);
+			chunk = Chunk();
+		}
+		if (state.meshOpen)
+			closeMesh(state, cache, cache.positions.size(), cache.uvs.size(), cache.normals.size());
+
+		//post processing is independent per mesh
+		if (calcnormals || calctangents)
+		{
+			std::vector<OBJMesh*> meshes;
+			for (auto& object : result.objects)
+			{
+				for (auto& mesh : object.meshes)
+					meshes.push_back(&mesh);
+			}
+			std::atomic<size_t> next(0);
+			auto postprocess = [&meshes, &next, calcnormals, calctangents]()
+			{
+				for (size_t i = next++; i < meshes.size(); i = next++)
+				{
+					if (calcnormals)
+						recalculateNormals(*meshes[i]);
+					if (calctangents)
+						recalculateTangents(*meshes[i]);
+				}
+			};
+			if (meshes.size() == 1)
+			{
+				//a single mesh gets all threads itself
+				if (calcnormals)
+					recalculateNormals(*meshes[0], threads);
+				if (calctangents)
+					recalculateTangents(*meshes[0], threads);
+			}
+			else
+			{
+				workers.clear();
+				for (size_t i = 1; i < std::min(static_cast<size_t>(threads), meshes.size()); i++)
+					workers.push_back(std::thread(postprocess));
+				postprocess();
+				for (auto& worker : workers)
+					worker.join();
+			}
+		}
+
+		result.objname = objpath;
+		return result;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << "Error: Loading OBJ failed: " << ex.what() << "\n";
+		throw ex;
+	}
+}
+
+OBJResult OBJLoader::loadOBJCached(const std::string & objpath, bool calcnormals, bool calctangents, unsigned int threads, bool compressindices)
+{
+	std::string cachepath = objpath + ".vcmesh";
+	uint32_t flags = (calcnormals ? MeshCache::CalcNormals : 0u) | (calctangents ? MeshCache::CalcTangents : 0u);
+
+	OBJResult result;
+	if (MeshCache::read(cachepath, objpath, flags, result))
+	{
+		result.objname = objpath;
+		return result;
+	}
+
+	result = loadOBJMapped(objpath, calcnormals, calctangents, threads);
+	try
+	{
+		MeshCache::write(cachepath, objpath, flags, result, compressindices);
+	}
+	catch (const std::exception& ex)
+	{
+		//not fatal, the next start just parses the file again
+		std::cerr << "Warning: Writing mesh cache failed: " << ex.what() << "\n";
+	}
+	return result;
+}
+
+void OBJLoader::streamOBJ(const std::string & objpath, const MeshCallback & callback, size_t memorylimit, bool calcnormals, bool calctangents)
+{
+	try
+	{
+		MappedFile file;
+		try
+		{
+			file.open(objpath);
+		}
+		catch (const std::exception&)
+		{
+			throw std::logic_error("OBJ file not found.");
+		}
+		const char* begin = file.data();
+		const char* end = file.data() + file.size();
+
+		//one half for the vertex data, the other one for the mesh in progress
+		memorylimit = std::max<size_t>(memorylimit, 1u << 20);
+		StreamData data(end, memorylimit / 2);
+		size_t meshlimit = memorylimit / 2;
+		//rough peak per distinct vertex while a part is converted: VertexDef, hash table slot (with slack) and Vertex
+		const size_t vertexbytes = sizeof(VertexDef) + 2 * (sizeof(VertexKey) + sizeof(Index)) + sizeof(Vertex);
+
+		std::string objectname;
+		std::string meshname;
+		bool objectOpen = false;
+		bool meshOpen = false;
+		VertexHashTable meshvertset;
+		std::vector<VertexDef> meshverts;
+		std::vector<Index> meshindices;
+		std::vector<VertexDef> triangles;
+
+		auto emitMesh = [&]()
+		{
+			OBJMesh mesh;
+			mesh.name = meshname;
+			addVertexAttributes(mesh);
+			fillMeshFrom(mesh, data, meshverts, meshindices);
+			if (calcnormals)
+				recalculateNormals(mesh);
+			if (calctangents)
+				recalculateTangents(mesh);
+			meshvertset.clear();
+			meshverts.clear();
+			meshindices.clear();
+			callback(objectname, mesh);
+		};
+
+		//same structure as loadOBJMapped, but meshes are handed out as soon as they are closed
+		memscanhelper::Cursor cursor{ begin, end };
+		memscanhelper::Token command;
+		while (memscanhelper::peekToken(cursor, command))
+		{
+			if (command.is("v") || command.is("vt") || command.is("vn"))
+			{
+				if (!objectOpen)
+				{
+					objectname = "UNNAMED";
+					objectOpen = true;
+				}
+				//only remember where the data is, it is parsed when a mesh needs it
+				if (command.is("v"))
+					data.positions.add(cursor.pos);
+				else if (command.is("vt"))
+					data.uvs.add(cursor.pos);
+				else
+					data.normals.add(cursor.pos);
+				memscanhelper::skipLine(cursor);
+			}
+			else if (command.is("f"))
+			{
+				if (!objectOpen)
+				{
+					objectname = "UNNAMED";
+					objectOpen = true;
+				}
+				if (!meshOpen)
+				{
+					meshname = "UNGROUPED";
+					meshOpen = true;
+				}
+				triangles.clear();
+				parseFace(cursor, data.positions.size(), data.uvs.size(), data.normals.size(), triangles);
+				for (const auto& vdef : triangles)
+				{
+					Index idx = meshvertset.findOrInsert(vdef.key(), static_cast<Index>(meshverts.size()));
+					if (idx == meshverts.size())
+						meshverts.push_back(vdef);
+					meshindices.push_back(idx);
+				}
+				//mesh too big: hand out what we have and continue with a new part
+				if (meshverts.size() * vertexbytes + meshindices.size() * sizeof(Index) > meshlimit)
+					emitMesh();
+			}
+			else if (command.is("o") || command.is("g"))
+			{
+				bool isobject = command.is("o");
+				memscanhelper::readToken(cursor, command);
+				std::string name;
+				if (!memscanhelper::readLine(cursor, name))
+					throw OBJException(isobject ? "Error parsing object name." : "Error parsing mesh name.");
+				if (meshOpen)
+					emitMesh();
+				if (isobject)
+				{
+					objectname = std::move(name);
+					objectOpen = true;
+					meshOpen = false;
+				}
+				else
+				{
+					if (!objectOpen)
+					{
+						objectname = "UNNAMED";
+						objectOpen = true;
+					}
+					meshname = std::move(name);
+					meshOpen = true;
+				}
+			}
+			else
+			{
+				memscanhelper::skipLine(cursor);
+			}
+		}
+		if (meshOpen)
+			emitMesh();
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << "Error: Loading OBJ failed: " << ex.what() << "\n";
+		throw ex;
+	}
+}
+
 OBJObject OBJLoader::parseObject(DataCache& cache, std::ifstream & stream, bool calcnormals, bool calctangents)
 {
 	try
@@ -177,12 +494,9 @@ OBJMesh OBJLoader::parseMesh(DataCache & cache, std::ifstream & stream, bool cal
 	try
 	{
 		OBJMesh mesh;
-		mesh.atts.push_back(VertexAttribute{3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, position)});
-		mesh.atts.push_back(VertexAttribute{2, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, uv)});
-		mesh.atts.push_back(VertexAttribute{3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, normal)});
-		mesh.atts.push_back(VertexAttribute{3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, tangent)});
+		addVertexAttributes(mesh);
 
-		std::unordered_map<VertexDef, size_t, VertexDef::hash, VertexDef::equal_to> meshvertset; //collect distinct vertices
+		VertexHashTable meshvertset; //collect distinct vertices, maps to their index in meshverts
 
 		//later create actual vertices out of these and put them into the mesh
 		std::vector<VertexDef> meshverts; //for tracking order of insertion		
@@ -211,27 +525,24 @@ OBJMesh OBJLoader::parseMesh(DataCache & cache, std::ifstream & stream, bool cal
 			mesh.name = "UNGROUPED";
 		}
 
+		//triangles of the current face, reused for every face
+		std::vector<VertexDef> triangles;
+
 		//now process faces
 		while (istreamhelper::peekString(stream, command))
 		{
 			if (command == "f") //yay we found a face
 			{
-				Face face = parseFace(stream);
+				triangles.clear();
+				parseFace(stream, cache, triangles);
 				//process face data and build mesh
-				for (int i = 0; i < 3; i++)
+				for (const auto& vdef : triangles)
 				{
-					//add Vertexdefs and indices
-					auto it = meshvertset.find(face.verts[i]);
-					if (it != meshvertset.end())	//if Vertex def exists already, just get the index and push it onto index array
-					{
-						meshindices.push_back(static_cast<Index>(it->second));
-					}
-					else //if not, push a index pointing to the last pushed Vertex def, push Vertex def and insert it into the set
-					{
-						meshindices.push_back(static_cast<Index>(meshverts.size()));
-						meshverts.push_back(face.verts[i]);
-						meshvertset.insert(std::make_pair(face.verts[i], meshverts.size() - 1));
-					}					
+					//add Vertexdefs and indices. If the Vertex def is new, it gets the next free index and is pushed as well
+					Index idx = meshvertset.findOrInsert(vdef.key(), static_cast<Index>(meshverts.size()));
+					if (idx == meshverts.size())
+						meshverts.push_back(vdef);
+					meshindices.push_back(idx);
 				}
 			}
 			else if (command == "g" || command == "o") //found next mesh group
@@ -281,28 +592,45 @@ OBJMesh OBJLoader::parseMesh(DataCache & cache, std::ifstream & stream, bool cal
 	}
 }
 
-OBJLoader::Face OBJLoader::parseFace(std::ifstream & stream)
+void OBJLoader::parseFace(std::ifstream & stream, const DataCache & cache, std::vector<VertexDef>& triangles)
 {
 	try
 	{
-		std::string command;
-		Face face;
-		if ((stream >> command) && command == "f")
+		//"f" followed by a blank, read without a string token
+		stream >> std::ws;
+		if (stream.get() != 'f' || !std::isspace(stream.peek()))
+		{
+			throw OBJException("Error parsing face");
+		}
+
+		//vertex tokens are copied into a fixed buffer, the face ends with the line or a comment
+		char token[64];
+		VertexDef first, prev;
+		size_t count = 0;
+		int c = stream.peek();
+		while (true)
 		{
-			std::string vstr1, vstr2, vstr3;
-			if (stream >> vstr1 >> vstr2 >> vstr3)
+			while (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f')
 			{
-				face.verts.push_back(parseVertex(vstr1));
-				face.verts.push_back(parseVertex(vstr2));
-				face.verts.push_back(parseVertex(vstr3));
-				return face;
+				stream.get();
+				c = stream.peek();
 			}
-			else
+			if (c == std::char_traits<char>::eof() || c == '\n' || c == '#')
+				break;
+
+			size_t len = 0;
+			while (c != std::char_traits<char>::eof() && !std::isspace(c))
 			{
-				throw OBJException("Error parsing face");
+				if (len == sizeof(token))
+					throw OBJException("Error parsing face");
+				token[len++] = static_cast<char>(c);
+				stream.get();
+				c = stream.peek();
 			}
+			addFaceVertex(parseVertex(token, token + len, cache.positions.size(), cache.uvs.size(), cache.normals.size()),
+				count, first, prev, triangles);
 		}
-		else
+		if (count < 3)
 		{
 			throw OBJException("Error parsing face");
 		}
@@ -313,22 +641,284 @@ OBJLoader::Face OBJLoader::parseFace(std::ifstream & stream)
 	}
 }
 
-OBJLoader::VertexDef OBJLoader::parseVertex(const std::string& vstring)
+void OBJLoader::addFaceVertex(const VertexDef & vert, size_t & count, VertexDef & first, VertexDef & prev, std::vector<VertexDef>& triangles)
+{
+	//fan triangulation (v0, vi-1, vi) keeps the winding of the polygon
+	if (count == 0)
+	{
+		first = vert;
+	}
+	else if (count >= 2)
+	{
+		triangles.push_back(first);
+		triangles.push_back(prev);
+		triangles.push_back(vert);
+	}
+	prev = vert;
+	count++;
+}
+
+glm::vec3 OBJLoader::parsePosition(memscanhelper::Cursor & cursor)
 {
 	try
 	{
-		//buffer for v, vt, vn index
-		std::string att[3];
+		memscanhelper::Token command;
+		double x, y, z;
+		if (!(memscanhelper::readToken(cursor, command) && command.is("v") &&
+			memscanhelper::readDouble(cursor, x) && memscanhelper::readDouble(cursor, y) && memscanhelper::readDouble(cursor, z)))
+		{
+			throw OBJException("Error parsing v command.");
+		}
+		return glm::vec3(x, y, z);
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+glm::vec3 OBJLoader::parseNormal(memscanhelper::Cursor & cursor)
+{
+	try
+	{
+		memscanhelper::Token command;
+		double x, y, z;
+		if (!(memscanhelper::readToken(cursor, command) && command.is("vn") &&
+			memscanhelper::readDouble(cursor, x) && memscanhelper::readDouble(cursor, y) && memscanhelper::readDouble(cursor, z)))
+		{
+			throw OBJException("Error parsing vn command.");
+		}
+		return glm::vec3(x, y, z);
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+glm::vec2 OBJLoader::parseUV(memscanhelper::Cursor & cursor)
+{
+	try
+	{
+		memscanhelper::Token command;
+		double u, v;
+		if (!(memscanhelper::readToken(cursor, command) && command.is("vt") &&
+			memscanhelper::readDouble(cursor, u) && memscanhelper::readDouble(cursor, v)))
+		{
+			throw OBJException("Error parsing vt command.");
+		}
+		return glm::vec2(u, v);
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+void OBJLoader::parseFace(memscanhelper::Cursor & cursor, size_t npositions, size_t nuvs, size_t nnormals, std::vector<VertexDef>& triangles)
+{
+	try
+	{
+		memscanhelper::Token command;
+		if (!(memscanhelper::readToken(cursor, command) && command.is("f")))
+		{
+			throw OBJException("Error parsing face");
+		}
+
+		//the face ends with the line or a comment
+		VertexDef first, prev;
+		size_t count = 0;
+		while (true)
+		{
+			while (cursor.pos != cursor.end && *cursor.pos != '\n' && memscanhelper::isSpace(*cursor.pos))
+				++cursor.pos;
+			if (cursor.pos == cursor.end || *cursor.pos == '\n' || *cursor.pos == '#')
+				break;
+
+			const char* begin = cursor.pos;
+			while (cursor.pos != cursor.end && !memscanhelper::isSpace(*cursor.pos))
+				++cursor.pos;
+			addFaceVertex(parseVertex(begin, cursor.pos, npositions, nuvs, nnormals), count, first, prev, triangles);
+		}
+		if (count < 3)
+		{
+			throw OBJException("Error parsing face");
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+OBJLoader::Chunk OBJLoader::scanChunk(const char * begin, const char * end)
+{
+	try
+	{
+		Chunk chunk;
+		memscanhelper::Cursor cursor{ begin, end };
+		memscanhelper::Token command;
+
+		auto pushRecord = [&chunk](Chunk::RecordType type, size_t first)
+		{
+			chunk.records.push_back(Chunk::Record{ type, first, 0,
+				chunk.data.positions.size(), chunk.data.uvs.size(), chunk.data.normals.size() });
+		};
+
+		while (memscanhelper::peekToken(cursor, command))
+		{
+			if (command.is("v") || command.is("vt") || command.is("vn"))
+			{
+				//vertex data only matters to the structure if it opens an unnamed object
+				if (chunk.records.empty())
+					pushRecord(Chunk::RecordType::Data, 0);
+				if (command.is("v"))
+					chunk.data.positions.push_back(parsePosition(cursor));
+				else if (command.is("vt"))
+					chunk.data.uvs.push_back(parseUV(cursor));
+				else
+					chunk.data.normals.push_back(parseNormal(cursor));
+			}
+			else if (command.is("f"))
+			{
+				//relative indices can only be resolved against this chunk's data here, assembleChunk adds the global offsets
+				size_t ntriangles = chunk.faceverts.size() / 3;
+				parseFace(cursor, chunk.data.positions.size(), chunk.data.uvs.size(), chunk.data.normals.size(), chunk.faceverts);
+				if (chunk.records.empty() || chunk.records.back().type != Chunk::RecordType::Faces)
+					pushRecord(Chunk::RecordType::Faces, ntriangles);
+				chunk.records.back().count += chunk.faceverts.size() / 3 - ntriangles;
+			}
+			else if (command.is("o") || command.is("g"))
+			{
+				bool isobject = command.is("o");
+				memscanhelper::readToken(cursor, command);
+				std::string name;
+				if (!memscanhelper::readLine(cursor, name))
+					throw OBJException(isobject ? "Error parsing object name." : "Error parsing mesh name.");
+				pushRecord(isobject ? Chunk::RecordType::Object : Chunk::RecordType::Group, chunk.names.size());
+				chunk.names.push_back(std::move(name));
+			}
+			else
+			{
+				memscanhelper::skipLine(cursor);
+			}
+		}
+		return chunk;
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+void OBJLoader::assembleChunk(AssemblyState & state, DataCache & cache, const Chunk & chunk, size_t pbase, size_t uvbase, size_t nbase)
+{
+	try
+	{
+		//same structure as parseObject/parseMesh: vertex data or faces outside of an object open an unnamed one,
+		//faces outside of a group open an ungrouped mesh, g and o close the current mesh.
+		for (const auto& record : chunk.records)
+		{
+			switch (record.type)
+			{
+			case Chunk::RecordType::Data:
+				if (!state.objectOpen)
+					openObject(state, "UNNAMED");
+				break;
+			case Chunk::RecordType::Faces:
+				if (!state.objectOpen)
+					openObject(state, "UNNAMED");
+				if (!state.meshOpen)
+					openMesh(state, "UNGROUPED");
+				//closed triangle meshes have about half as many distinct vertices as triangles, more grow the table
+				state.meshvertset.reserve(state.meshverts.size() + record.count / 2);
+				state.meshindices.reserve(state.meshindices.size() + record.count * 3);
+				for (size_t i = record.first * 3; i < (record.first + record.count) * 3; i++)
+				{
+					VertexDef vdef = chunk.faceverts[i];
+					if (vdef.p_relative)
+						vdef.p_idx += static_cast<Index>(pbase);
+					if (vdef.uv_relative)
+						vdef.uv_idx += static_cast<Index>(uvbase);
+					if (vdef.n_relative)
+						vdef.n_idx += static_cast<Index>(nbase);
+					Index idx = state.meshvertset.findOrInsert(vdef.key(), static_cast<Index>(state.meshverts.size()));
+					if (idx == state.meshverts.size())
+						state.meshverts.push_back(vdef);
+					state.meshindices.push_back(idx);
+				}
+				break;
+			case Chunk::RecordType::Group:
+				if (!state.objectOpen)
+					openObject(state, "UNNAMED");
+				if (state.meshOpen)
+					closeMesh(state, cache, pbase + record.positions, uvbase + record.uvs, nbase + record.normals);
+				openMesh(state, chunk.names[record.first]);
+				break;
+			case Chunk::RecordType::Object:
+				if (state.meshOpen)
+					closeMesh(state, cache, pbase + record.positions, uvbase + record.uvs, nbase + record.normals);
+				openObject(state, chunk.names[record.first]);
+				break;
+			}
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+void OBJLoader::openObject(AssemblyState & state, const std::string & name)
+{
+	OBJObject object;
+	object.name = name;
+	state.result->objects.push_back(std::move(object));
+	state.objectOpen = true;
+}
+
+void OBJLoader::openMesh(AssemblyState & state, const std::string & name)
+{
+	state.mesh = OBJMesh();
+	state.mesh.name = name;
+	addVertexAttributes(state.mesh);
+	state.meshvertset.clear();
+	state.meshverts.clear();
+	state.meshindices.clear();
+	state.meshOpen = true;
+}
 
+void OBJLoader::closeMesh(AssemblyState & state, DataCache & cache, size_t plimit, size_t uvlimit, size_t nlimit)
+{
+	fillMesh(state.mesh, cache, state.meshverts, state.meshindices, plimit, uvlimit, nlimit);
+	state.result->objects.back().meshes.push_back(std::move(state.mesh));
+	state.meshOpen = false;
+}
+
+OBJLoader::VertexDef OBJLoader::parseVertex(const char* begin, const char* end, size_t npositions, size_t nuvs, size_t nnormals)
+{
+	try
+	{
+		//v, vt, vn index
+		uint64_t att[3] = { 0, 0, 0 };
+		bool attdefined[3] = { false, false, false };
+		bool attnegative[3] = { false, false, false };
 		int attct = 0;
 
-		for (size_t i = 0; i < vstring.length(); i++)
+		for (const char* c = begin; c != end; ++c)
 		{
-			if (isdigit(vstring[i]))
+			if (*c >= '0' && *c <= '9')
+			{
+				att[attct] = att[attct] * 10 + static_cast<uint64_t>(*c - '0');
+				if (att[attct] > 0xFFFFFFFFull)
+					throw OBJException("Error parsing Vertex. Index out of range.");
+				attdefined[attct] = true;
+			}
+			else if (*c == '-' && !attdefined[attct] && !attnegative[attct])
 			{
-				att[attct] += vstring[i];
+				attnegative[attct] = true;
 			}
-			else if (vstring[i] == '/')
+			else if (*c == '/' && attct < 2)
 			{
 				attct++;
 			}
@@ -338,13 +928,28 @@ OBJLoader::VertexDef OBJLoader::parseVertex(const std::string& vstring)
 			}
 		}
 
+		//1 based indices, negative ones count back from the end of the data read so far (-1: last element).
+		//Out of range results wrap around and are rejected by fillMesh.
+		const size_t counts[3] = { npositions, nuvs, nnormals };
+		Index idx[3] = { 0, 0, 0 };
+		for (int i = 0; i < 3; i++)
+		{
+			if (attnegative[i] && (!attdefined[i] || att[i] == 0))
+				throw OBJException("Error parsing Vertex.");
+			if (attdefined[i])
+				idx[i] = attnegative[i] ? static_cast<Index>(counts[i] - att[i]) : static_cast<Index>(att[i]) - 1;
+		}
+
 		VertexDef vert;
-		vert.p_idx = (att[0].length() > 0 ? std::stoi(att[0]) - 1 : 0);
-		vert.p_defined = (att[0].length() > 0 ? true : false);
-		vert.uv_idx = (att[1].length() > 0 ? std::stoi(att[1]) - 1 : 0);
-		vert.uv_defined = (att[1].length() > 0 ? true : false);
-		vert.n_idx = (att[2].length() > 0 ? std::stoi(att[2]) - 1 : 0);
-		vert.n_defined = (att[2].length() > 0 ? true : false);
+		vert.p_idx = idx[0];
+		vert.p_defined = attdefined[0];
+		vert.p_relative = attnegative[0];
+		vert.uv_idx = idx[1];
+		vert.uv_defined = attdefined[1];
+		vert.uv_relative = attnegative[1];
+		vert.n_idx = idx[2];
+		vert.n_defined = attdefined[2];
+		vert.n_relative = attnegative[2];
 		return vert;
 	}
 	catch (const std::exception& ex)
@@ -353,7 +958,19 @@ OBJLoader::VertexDef OBJLoader::parseVertex(const std::string& vstring)
 	}
 }
 
-void OBJLoader::fillMesh(OBJMesh & mesh, DataCache & cache, std::vector<VertexDef> vdefs, std::vector<Index>& indices)
+void OBJLoader::fillMesh(OBJMesh & mesh, DataCache & cache, const std::vector<VertexDef>& vdefs, std::vector<Index>& indices)
+{
+	fillMesh(mesh, cache, vdefs, indices, cache.positions.size(), cache.uvs.size(), cache.normals.size());
+}
+
+void OBJLoader::fillMesh(OBJMesh & mesh, DataCache & cache, const std::vector<VertexDef>& vdefs, std::vector<Index>& indices, size_t plimit, size_t uvlimit, size_t nlimit)
+{
+	CacheView view = { cache, plimit, uvlimit, nlimit };
+	fillMeshFrom(mesh, view, vdefs, indices);
+}
+
+template <typename Data>
+void OBJLoader::fillMeshFrom(OBJMesh & mesh, Data & data, const std::vector<VertexDef>& vdefs, std::vector<Index>& indices)
 {
 	try
 	{
@@ -362,15 +979,14 @@ void OBJLoader::fillMesh(OBJMesh & mesh, DataCache & cache, std::vector<VertexDe
 		bool hasverts = true;
 		bool hasuvs = true;
 		bool hasnormals = true;
+		mesh.vertices.reserve(mesh.vertices.size() + vdefs.size());
 		for (size_t i = 0; i < vdefs.size(); i++)
 		{
 			Vertex vert;
 
 			if (vdefs[i].p_defined)
 			{
-				if(vdefs[i].p_idx < static_cast<Index>(cache.positions.size()))
-					vert.position = cache.positions[vdefs[i].p_idx];
-				else
+				if (!data.position(vdefs[i].p_idx, vert.position))
 					throw OBJException("Missing position in object definition");
 			}
 			else
@@ -380,9 +996,7 @@ void OBJLoader::fillMesh(OBJMesh & mesh, DataCache & cache, std::vector<VertexDe
 
 			if (vdefs[i].uv_defined)
 			{
-				if (vdefs[i].uv_idx < static_cast<Index>(cache.uvs.size()))
-					vert.uv = cache.uvs[vdefs[i].uv_idx];
-				else
+				if (!data.uv(vdefs[i].uv_idx, vert.uv))
 					throw OBJException("Missing texture coordinate in object definition");
 			}
 			else
@@ -392,9 +1006,7 @@ void OBJLoader::fillMesh(OBJMesh & mesh, DataCache & cache, std::vector<VertexDe
 
 			if (vdefs[i].n_defined)
 			{
-				if (vdefs[i].n_idx < static_cast<Index>(cache.normals.size()))
-					vert.normal = cache.normals[vdefs[i].n_idx];
-				else
+				if (!data.normal(vdefs[i].n_idx, vert.normal))
 					throw OBJException("Missing normal in object definition");
 			}
 			else
@@ -405,6 +1017,7 @@ void OBJLoader::fillMesh(OBJMesh & mesh, DataCache & cache, std::vector<VertexDe
 			mesh.vertices.push_back(vert);
 		}
 		mesh.indices = std::move(indices);
+		mesh.indexType = selectIndexType(mesh.vertices.size());
 		mesh.hasPositions = hasverts;
 		mesh.hasUVs = hasuvs;
 		mesh.hasNormals = hasnormals;
@@ -415,112 +1028,362 @@ void OBJLoader::fillMesh(OBJMesh & mesh, DataCache & cache, std::vector<VertexDe
 	}
 }
 
-void OBJLoader::recalculateNormals(OBJMesh & mesh)
+void OBJLoader::addVertexAttributes(OBJMesh & mesh)
 {
-	try
+	mesh.atts.push_back(VertexAttribute{3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, position), GL_FALSE});
+	mesh.atts.push_back(VertexAttribute{2, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, uv), GL_FALSE});
+	mesh.atts.push_back(VertexAttribute{3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, normal), GL_FALSE});
+	mesh.atts.push_back(VertexAttribute{3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, tangent), GL_FALSE});
+}
+
+bool OBJLoader::CacheView::position(Index i, glm::vec3 & out) const
+{
+	if (i >= plimit)
+		return false;
+	out = cache.positions[i];
+	return true;
+}
+
+bool OBJLoader::CacheView::uv(Index i, glm::vec2 & out) const
+{
+	if (i >= uvlimit)
+		return false;
+	out = cache.uvs[i];
+	return true;
+}
+
+bool OBJLoader::CacheView::normal(Index i, glm::vec3 & out) const
+{
+	if (i >= nlimit)
+		return false;
+	out = cache.normals[i];
+	return true;
+}
+
+template <typename T>
+const size_t OBJLoader::DataBlockCache<T>::BLOCK_SIZE;
+template <typename T>
+const uint32_t OBJLoader::DataBlockCache<T>::NO_SLOT;
+
+template <typename T>
+OBJLoader::DataBlockCache<T>::DataBlockCache(const char * command, ParseFunc parse, const char * end, size_t maxbytes) :
+	m_command(command),
+	m_parse(parse),
+	m_end(end),
+	m_maxSlots(std::max<size_t>(1, maxbytes / (BLOCK_SIZE * sizeof(T) + 2 * sizeof(size_t) + 1))),
+	m_count(0),
+	m_hand(0)
+{
+}
+
+template <typename T>
+void OBJLoader::DataBlockCache<T>::add(const char * line)
+{
+	if (m_count % BLOCK_SIZE == 0)
 	{
-		for (size_t i = 0; i < mesh.vertices.size(); i++) //initialize all Vertex normals with nullvectors
+		m_blockStarts.push_back(line);
+		m_blockSlots.push_back(NO_SLOT);
+	}
+	m_count++;
+}
+
+template <typename T>
+bool OBJLoader::DataBlockCache<T>::get(size_t i, T & out)
+{
+	if (i >= m_count)
+		return false;
+	size_t block = i / BLOCK_SIZE;
+	uint32_t slot = m_blockSlots[block];
+	if (slot == NO_SLOT)
+	{
+		if (m_slotBlocks.size() < m_maxSlots)
 		{
-			mesh.vertices[i].normal = glm::vec3(0.0f, 0.0f, 0.0f);
+			//still room for another slot
+			slot = static_cast<uint32_t>(m_slotBlocks.size());
+			m_slotBlocks.push_back(block);
+			m_slotValid.push_back(0);
+			m_slotUsed.push_back(0);
+			m_slotData.resize(m_slotData.size() + BLOCK_SIZE);
 		}
-
-		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		else
 		{
-			glm::vec3 v1 = mesh.vertices[mesh.indices[i]].position;
-			glm::vec3 v2 = mesh.vertices[mesh.indices[i + 1]].position;
-			glm::vec3 v3 = mesh.vertices[mesh.indices[i + 2]].position;
+			//clock: evict the next slot that wasn't used since the hand passed it last time
+			while (m_slotUsed[m_hand])
+			{
+				m_slotUsed[m_hand] = 0;
+				m_hand = (m_hand + 1) % m_slotBlocks.size();
+			}
+			slot = static_cast<uint32_t>(m_hand);
+			m_hand = (m_hand + 1) % m_slotBlocks.size();
+			m_blockSlots[m_slotBlocks[slot]] = NO_SLOT;
+			m_slotBlocks[slot] = block;
+		}
+		m_blockSlots[block] = slot;
+		load(block, slot);
+	}
+	else if (i % BLOCK_SIZE >= m_slotValid[slot])
+	{
+		//block got more elements since it was loaded
+		load(block, slot);
+	}
+	m_slotUsed[slot] = 1;
+	out = m_slotData[slot * BLOCK_SIZE + i % BLOCK_SIZE];
+	return true;
+}
 
-			//counter clockwise winding
-			glm::vec3 edge1 = v2 - v1;
-			glm::vec3 edge2 = v3 - v1;
+template <typename T>
+void OBJLoader::DataBlockCache<T>::load(size_t block, size_t slot)
+{
+	size_t count = std::min(BLOCK_SIZE, m_count - block * BLOCK_SIZE);
+	T* out = &m_slotData[slot * BLOCK_SIZE];
+	memscanhelper::Cursor cursor{ m_blockStarts[block], m_end };
+	memscanhelper::Token command;
+	//other lines may be interleaved with the ones of this block
+	for (size_t i = 0; i < count;)
+	{
+		if (!memscanhelper::peekToken(cursor, command))
+			throw OBJException("Error reading vertex data.");
+		if (command.is(m_command))
+			out[i++] = m_parse(cursor);
+		else
+			memscanhelper::skipLine(cursor);
+	}
+	m_slotValid[slot] = count;
+}
 
-			glm::vec3 normal = glm::cross(edge1, edge2);
+OBJLoader::StreamData::StreamData(const char * end, size_t maxbytes) :
+	positions("v", &OBJLoader::parsePosition, end, maxbytes / 2),
+	uvs("vt", &OBJLoader::parseUV, end, maxbytes / 4),
+	normals("vn", &OBJLoader::parseNormal, end, maxbytes / 4)
+{
+}
 
-			//for each Vertex all corresponing normals are added. The result is a non unit length vector wich is the average direction of all assigned normals.
-			mesh.vertices[mesh.indices[i]].normal += normal;
-			mesh.vertices[mesh.indices[i + 1]].normal += normal;
-			mesh.vertices[mesh.indices[i + 2]].normal += normal;
+namespace
+{
+	//runs func(first, last, thread) for threads equal parts of [0, count) and rethrows the first error
+	template <typename Func>
+	void parallelFor(unsigned int threads, size_t count, const Func& func)
+	{
+		std::vector<std::exception_ptr> errors(threads);
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < threads; t++)
+		{
+			workers.push_back(std::thread([&func, &errors, count, threads, t]()
+			{
+				try
+				{
+					func(count * t / threads, count * (t + 1) / threads, t);
+				}
+				catch (...)
+				{
+					errors[t] = std::current_exception();
+				}
+			}));
+		}
+		try
+		{
+			func(0, count / threads, 0u);
 		}
+		catch (...)
+		{
+			errors[0] = std::current_exception();
+		}
+		for (auto& worker : workers)
+			worker.join();
+		for (auto& error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+	}
+
+	//don't spawn threads for small meshes
+	unsigned int postProcessThreads(unsigned int threads, size_t triangles)
+	{
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		return static_cast<unsigned int>(std::min(static_cast<size_t>(threads), triangles / 65536 + 1));
+	}
 
-		for (size_t i = 0; i < mesh.vertices.size(); i++)	//normalize all normals calculated in the previous step
+	//one member of every element of an array of structs, e.g. the normals of the vertices
+	template <typename T>
+	struct Strided
+	{
+		char* base;
+		size_t stride;
+
+		T& operator[](size_t i) const
 		{
-			mesh.vertices[i].normal = glm::normalize(mesh.vertices[i].normal);
+			return *reinterpret_cast<T*>(base + i * stride);
 		}
+	};
 
-		mesh.hasNormals = true;
+	template <typename T>
+	Strided<T> vertexMember(std::vector<Vertex>& vertices, size_t offset)
+	{
+		return Strided<T>{ reinterpret_cast<char*>(vertices.data()) + offset, sizeof(Vertex) };
 	}
-	catch (const std::exception& ex)
+
+	Strided<glm::vec3> buffer(std::vector<glm::vec3>& data)
 	{
-		throw ex;
+		return Strided<glm::vec3>{ reinterpret_cast<char*>(data.data()), sizeof(glm::vec3) };
 	}
-}
 
-void OBJLoader::recalculateTangents(OBJMesh & mesh)
-{
-	try
+	//accumulation targets: thread 0 works on the vertices directly, the others on their own buffers
+	struct Accumulators
 	{
-		if (mesh.hasUVs)
-		{
-			//initialize tangents and bitangents with nullvecs
-			for (size_t i = 0; i < mesh.vertices.size(); i++)
-			{
-				mesh.vertices[i].tangent = glm::vec3(0.0f, 0.0f, 0.0f);
-			}
+		Strided<glm::vec3> target;
+		std::vector<std::vector<glm::vec3>> buffers;	//index 0 unused
 
-			float det;
-			glm::vec3 tangent;
-			glm::vec3 normal;
+		Strided<glm::vec3> get(unsigned int thread)
+		{
+			return thread == 0 ? target : buffer(buffers[thread]);
+		}
 
-			//calculate and average tangents and bitangents just as we did when calculating the normals
-			for (size_t i = 0; i < mesh.indices.size(); i += 3)
-			{
-				//3 vertices of a triangle
-				glm::vec3 v1 = mesh.vertices[mesh.indices[i]].position;
-				glm::vec3 v2 = mesh.vertices[mesh.indices[i + 1]].position;
-				glm::vec3 v3 = mesh.vertices[mesh.indices[i + 2]].position;
+		//target + buffer 1 + ... + buffer n-1
+		glm::vec3 sum(size_t i) const
+		{
+			glm::vec3 value = target[i];
+			for (size_t b = 1; b < buffers.size(); b++)
+				value += buffers[b][i];
+			return value;
+		}
+	};
 
-				//uvs
-				glm::vec2 uv1 = mesh.vertices[mesh.indices[i]].uv;
-				glm::vec2 uv2 = mesh.vertices[mesh.indices[i + 1]].uv;
-				glm::vec2 uv3 = mesh.vertices[mesh.indices[i + 2]].uv;
+	//face normals of the triangles [first, last), added to their corners
+	void accumulateNormals(const Strided<glm::vec3>& positions, const Index* indices, size_t first, size_t last, const Strided<glm::vec3>& acc)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			const Index* corners = &indices[i * 3];
+			glm::vec3 v1 = positions[corners[0]];
+			glm::vec3 normal = glm::cross(positions[corners[1]] - v1, positions[corners[2]] - v1);
+			acc[corners[0]] += normal;
+			acc[corners[1]] += normal;
+			acc[corners[2]] += normal;
+		}
+	}
 
-				//calculate edges in counter clockwise winding order
-				glm::vec3 edge1 = v2 - v1;
-				glm::vec3 edge2 = v3 - v1;
+	//uv aligned tangents of the triangles [first, last), added to their corners
+	void accumulateTangents(const Strided<glm::vec3>& positions, const Strided<glm::vec2>& uvs, const Index* indices, size_t first, size_t last, const Strided<glm::vec3>& acc)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			const Index* corners = &indices[i * 3];
+			glm::vec3 v1 = positions[corners[0]];
+			glm::vec3 edge1 = positions[corners[1]] - v1;
+			glm::vec3 edge2 = positions[corners[2]] - v1;
+			glm::vec2 uv1 = uvs[corners[0]];
+			glm::vec2 duv1 = uvs[corners[1]] - uv1;
+			glm::vec2 duv2 = uvs[corners[2]] - uv1;
 
-				//deltaus and deltavs
-				glm::vec2 duv1 = uv2 - uv1;
-				glm::vec2 duv2 = uv3 - uv1;
+			float det = duv1.x * duv2.y - duv2.x * duv1.y;
+			glm::vec3 tangent;
+			if (fabs(det) < 1e-6f)
+			{
+				tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+			}
+			else
+			{
+				det = 1.0f / det;
+				tangent.x = det * (duv2.y * edge1.x - duv1.y * edge2.x);
+				tangent.y = det * (duv2.y * edge1.y - duv1.y * edge2.y);
+				tangent.z = det * (duv2.y * edge1.z - duv1.y * edge2.z);
+			}
+			acc[corners[0]] += tangent;
+			acc[corners[1]] += tangent;
+			acc[corners[2]] += tangent;
+		}
+	}
+}
 
-				det = duv1.x * duv2.y - duv2.x * duv1.y;
+void OBJLoader::recalculateNormals(OBJMesh & mesh, unsigned int threads)
+{
+	try
+	{
+		size_t nverts = mesh.vertices.size();
+		size_t ntris = mesh.indices.size() / 3;
+		if (nverts > 0)
+		{
+			threads = postProcessThreads(threads, ntris);
+			Strided<glm::vec3> positions = vertexMember<glm::vec3>(mesh.vertices, offsetof(Vertex, position));
+			Strided<glm::vec3> normals = vertexMember<glm::vec3>(mesh.vertices, offsetof(Vertex, normal));
 
-				if (fabs(det) < 1e-6f)		//if delta stuff is close to nothing ignore it
+			//for each Vertex all corresponing normals are added. The result is a non unit length vector wich is the average direction of all assigned normals.
+			//counter clockwise winding
+			Accumulators acc{ normals, std::vector<std::vector<glm::vec3>>(threads) };
+			parallelFor(threads, ntris, [&](size_t first, size_t last, unsigned int t)
+			{
+				if (t == 0)
 				{
-					tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+					for (size_t i = 0; i < nverts; i++)
+						normals[i] = glm::vec3(0.0f, 0.0f, 0.0f);
 				}
 				else
 				{
-					det = 1.0f / det;
-
-					tangent.x = det * (duv2.y * edge1.x - duv1.y * edge2.x);
-					tangent.y = det * (duv2.y * edge1.y - duv1.y * edge2.y);
-					tangent.z = det * (duv2.y * edge1.z - duv1.y * edge2.z);
+					acc.buffers[t].assign(nverts, glm::vec3(0.0f, 0.0f, 0.0f));
 				}
+				accumulateNormals(positions, mesh.indices.data(), first, last, acc.get(t));
+			});
 
-				mesh.vertices[mesh.indices[i]].tangent += tangent;
-				mesh.vertices[mesh.indices[i + 1]].tangent += tangent;
-				mesh.vertices[mesh.indices[i + 2]].tangent += tangent;
-			}
+			//normalize all normals calculated in the previous step
+			parallelFor(threads, nverts, [&](size_t first, size_t last, unsigned int)
+			{
+				for (size_t i = first; i < last; i++)
+					normals[i] = glm::normalize(acc.sum(i));
+			});
+		}
+		mesh.hasNormals = true;
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
 
-			//orthogonalize and normalize tangents
-			for (size_t i = 0; i < mesh.vertices.size(); i++)
+void OBJLoader::recalculateTangents(OBJMesh & mesh, unsigned int threads)
+{
+	try
+	{
+		if (mesh.hasUVs)
+		{
+			size_t nverts = mesh.vertices.size();
+			size_t ntris = mesh.indices.size() / 3;
+			if (nverts > 0)
 			{
-				//normalize the stuff from before
-				mesh.vertices[i].normal = glm::normalize(mesh.vertices[i].normal);
-				mesh.vertices[i].tangent = glm::normalize(mesh.vertices[i].tangent);
+				threads = postProcessThreads(threads, ntris);
+				Strided<glm::vec3> positions = vertexMember<glm::vec3>(mesh.vertices, offsetof(Vertex, position));
+				Strided<glm::vec2> uvs = vertexMember<glm::vec2>(mesh.vertices, offsetof(Vertex, uv));
+				Strided<glm::vec3> normals = vertexMember<glm::vec3>(mesh.vertices, offsetof(Vertex, normal));
+				Strided<glm::vec3> tangents = vertexMember<glm::vec3>(mesh.vertices, offsetof(Vertex, tangent));
 
-				//gram schmidt reorthogonalize normal-tangent system
-				mesh.vertices[i].tangent = glm::normalize(mesh.vertices[i].tangent - (glm::dot(mesh.vertices[i].normal, mesh.vertices[i].tangent) * mesh.vertices[i].normal));
+				//calculate and average tangents just as we did when calculating the normals
+				Accumulators acc{ tangents, std::vector<std::vector<glm::vec3>>(threads) };
+				parallelFor(threads, ntris, [&](size_t first, size_t last, unsigned int t)
+				{
+					if (t == 0)
+					{
+						for (size_t i = 0; i < nverts; i++)
+							tangents[i] = glm::vec3(0.0f, 0.0f, 0.0f);
+					}
+					else
+					{
+						acc.buffers[t].assign(nverts, glm::vec3(0.0f, 0.0f, 0.0f));
+					}
+					accumulateTangents(positions, uvs, mesh.indices.data(), first, last, acc.get(t));
+				});
+
+				//orthogonalize and normalize tangents
+				parallelFor(threads, nverts, [&](size_t first, size_t last, unsigned int)
+				{
+					for (size_t i = first; i < last; i++)
+					{
+						glm::vec3 normal = glm::normalize(normals[i]);
+						glm::vec3 tangent = glm::normalize(acc.sum(i));
+						normals[i] = normal;
+						tangents[i] = glm::normalize(tangent - (glm::dot(normal, tangent) * normal));
+					}
+				});
 			}
 			mesh.hasTangents = true;
 		}
@@ -548,6 +1411,56 @@ void OBJLoader::reverseWinding(OBJMesh & mesh)
 	}
 }
 
+GLenum OBJLoader::selectIndexType(size_t vertexcount)
+{
+	return vertexcount < 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t OBJLoader::getIndexSize(GLenum type)
+{
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_UNSIGNED_SHORT:
+		return 2;
+	case GL_UNSIGNED_INT:
+		return 4;
+	default:
+		throw std::logic_error("Invalid index type.");
+	}
+}
+
+void OBJLoader::uploadIndices(const OBJMesh & mesh, GLenum target, GLenum usage)
+{
+	try
+	{
+		if (mesh.indexType == GL_UNSIGNED_SHORT)
+		{
+			std::vector<GLushort> narrow(mesh.indices.size());
+			for (size_t i = 0; i < mesh.indices.size(); i++)
+			{
+				if (mesh.indices[i] > 0xFFFF)
+					throw std::logic_error("Index out of range for GL_UNSIGNED_SHORT.");
+				narrow[i] = static_cast<GLushort>(mesh.indices[i]);
+			}
+			glBufferData(target, narrow.size() * sizeof(GLushort), narrow.data(), usage);
+		}
+		else if (mesh.indexType == GL_UNSIGNED_INT)
+		{
+			glBufferData(target, mesh.indices.size() * sizeof(Index), mesh.indices.data(), usage);
+		}
+		else
+		{
+			throw std::logic_error("Unsupported index type.");
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
 bool istreamhelper::peekString(std::istream& stream, std::string& out)
 {
 	try
@@ -590,3 +1503,167 @@ bool istreamhelper::consumeString(std::istream& stream)
 		throw ex;
 	}
 }
+
+bool memscanhelper::peekToken(Cursor & cursor, Token & out)
+{
+	skipSpace(cursor);
+	if (cursor.pos == cursor.end)
+		return false;
+	const char* c = cursor.pos;
+	while (c != cursor.end && !isSpace(*c))
+		++c;
+	out.begin = cursor.pos;
+	out.end = c;
+	return true;
+}
+
+bool memscanhelper::readToken(Cursor & cursor, Token & out)
+{
+	if (!peekToken(cursor, out))
+		return false;
+	cursor.pos = out.end;
+	return true;
+}
+
+void memscanhelper::skipLine(Cursor & cursor)
+{
+	while (cursor.pos != cursor.end && *cursor.pos != '\n')
+		++cursor.pos;
+	if (cursor.pos != cursor.end)
+		++cursor.pos;
+}
+
+bool memscanhelper::readLine(Cursor & cursor, std::string & out)
+{
+	//behaves like std::getline: fails only if nothing is left to read
+	if (cursor.pos == cursor.end)
+		return false;
+	const char* start = cursor.pos;
+	while (cursor.pos != cursor.end && *cursor.pos != '\n')
+		++cursor.pos;
+	out.assign(start, cursor.pos);
+	if (cursor.pos != cursor.end)
+		++cursor.pos;
+	return true;
+}
+
+bool memscanhelper::readDouble(Cursor & cursor, double & out)
+{
+	//powers of ten that are exactly representable as double
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	skipSpace(cursor);
+	const char* c = cursor.pos;
+	const char* end = cursor.end;
+	const char* start = c;
+
+	bool negative = false;
+	if (c != end && (*c == '+' || *c == '-'))
+	{
+		negative = (*c == '-');
+		++c;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;			//significant digits in mantissa
+	int exponent = 0;
+	bool truncated = false;	//more than 19 significant digits
+	bool anydigit = false;
+
+	for (; c != end && *c >= '0' && *c <= '9'; ++c)
+	{
+		anydigit = true;
+		unsigned d = static_cast<unsigned>(*c - '0');
+		if (mantissa == 0 && d == 0)
+			continue;
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + d;
+			digits++;
+		}
+		else
+		{
+			exponent++;
+			truncated = true;
+		}
+	}
+	if (c != end && *c == '.')
+	{
+		++c;
+		for (; c != end && *c >= '0' && *c <= '9'; ++c)
+		{
+			anydigit = true;
+			unsigned d = static_cast<unsigned>(*c - '0');
+			if (mantissa == 0 && d == 0)
+			{
+				exponent--;
+			}
+			else if (digits < 19)
+			{
+				mantissa = mantissa * 10 + d;
+				digits++;
+				exponent--;
+			}
+			else
+			{
+				truncated = true;
+			}
+		}
+	}
+	if (!anydigit)
+		return false;
+	if (c != end && (*c == 'e' || *c == 'E'))
+	{
+		++c;
+		bool expnegative = false;
+		if (c != end && (*c == '+' || *c == '-'))
+		{
+			expnegative = (*c == '-');
+			++c;
+		}
+		if (c == end || *c < '0' || *c > '9')
+			return false;
+		int expvalue = 0;
+		for (; c != end && *c >= '0' && *c <= '9'; ++c)
+		{
+			if (expvalue < 100000)
+				expvalue = expvalue * 10 + (*c - '0');
+		}
+		exponent += (expnegative ? -expvalue : expvalue);
+	}
+	if (c != end && !isSpace(*c))
+		return false;
+
+	if (!truncated && digits <= 15 && exponent >= -22 && exponent <= 22)
+	{
+		//mantissa and power of ten are exact, so a single multiplication or division is correctly rounded
+		double value = static_cast<double>(mantissa);
+		if (exponent < 0)
+			value /= pow10[-exponent];
+		else
+			value *= pow10[exponent];
+		out = negative ? -value : value;
+	}
+	else
+	{
+		//rare long or extreme numbers: fall back to strtod on a copy of the token
+		size_t len = static_cast<size_t>(c - start);
+		char buffer[128];
+		if (len < sizeof(buffer))
+		{
+			std::memcpy(buffer, start, len);
+			buffer[len] = '\0';
+			out = std::strtod(buffer, nullptr);
+		}
+		else
+		{
+			std::string longnumber(start, c);
+			out = std::strtod(longnumber.c_str(), nullptr);
+		}
+	}
+	cursor.pos = c;
+	return true;
+}
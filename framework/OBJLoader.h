@@ -9,7 +9,9 @@
 #include <iostream>
 #include <cctype>
 #include <unordered_map>
+#include <functional>
 #include <CommonTypes.h>
+#include <VertexHashTable.h>
 
 //------------------------------ istream string helper ----------------------------------------
 
@@ -47,6 +49,53 @@ public:
 	}
 };
 
+//------------------------------ in memory text helper ----------------------------------------
+//works directly on a (memory mapped) character buffer. Tokens are [begin, end) ranges into that buffer.
+
+class memscanhelper
+{
+public:
+	struct Cursor
+	{
+		const char* pos;
+		const char* end;
+	};
+
+	struct Token
+	{
+		const char* begin;
+		const char* end;
+
+		bool is(const char* literal) const
+		{
+			const char* c = begin;
+			for (; c != end && *literal; ++c, ++literal)
+			{
+				if (*c != *literal)
+					return false;
+			}
+			return c == end && *literal == '\0';
+		}
+	};
+
+	static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+	static void skipSpace(Cursor& cursor)
+	{
+		while (cursor.pos != cursor.end && isSpace(*cursor.pos))
+			++cursor.pos;
+	}
+
+	static bool peekToken(Cursor& cursor, Token& out);
+	static bool readToken(Cursor& cursor, Token& out);
+	static void skipLine(Cursor& cursor);
+	static bool readLine(Cursor& cursor, std::string& out);
+	//same result as "stream >> double" but without locale or allocation overhead
+	static bool readDouble(Cursor& cursor, double& out);
+};
+
 //------------------------------ Data Structures to hold the result ---------------------------
 class OBJException : public std::logic_error
 {
@@ -66,7 +115,11 @@ public:
 		hasPositions(false),
 		hasUVs(false),
 		hasNormals(false),
-		hasTangents(false)
+		hasTangents(false),
+		indexType(GL_UNSIGNED_INT),
+		packed(false),
+		positionOffset(0.0f),
+		positionScale(1.0f)
 	{}
 	OBJMesh(const OBJMesh& other) :
 		name(other.name),
@@ -76,7 +129,12 @@ public:
 		hasTangents(other.hasTangents),
 		vertices(other.vertices),
 		indices(other.indices),
-		atts(other.atts)
+		indexType(other.indexType),
+		atts(other.atts),
+		packed(other.packed),
+		packedVertices(other.packedVertices),
+		positionOffset(other.positionOffset),
+		positionScale(other.positionScale)
 	{}
 	OBJMesh(OBJMesh&& other) :
 		name(std::move(other.name)),
@@ -86,7 +144,12 @@ public:
 		hasTangents(other.hasTangents),
 		vertices(std::move(other.vertices)),
 		indices(std::move(other.indices)),
-		atts(std::move(other.atts))
+		indexType(other.indexType),
+		atts(std::move(other.atts)),
+		packed(other.packed),
+		packedVertices(std::move(other.packedVertices)),
+		positionOffset(other.positionOffset),
+		positionScale(other.positionScale)
 	{}
 	~OBJMesh() {}
 
@@ -101,7 +164,12 @@ public:
 		this->hasTangents = other.hasTangents;
 		this->vertices = other.vertices;
 		this->indices = other.indices;
+		this->indexType = other.indexType;
 		this->atts = other.atts;
+		this->packed = other.packed;
+		this->packedVertices = other.packedVertices;
+		this->positionOffset = other.positionOffset;
+		this->positionScale = other.positionScale;
 
 		return *this;
 	}
@@ -116,7 +184,12 @@ public:
 		this->hasTangents = other.hasTangents;
 		this->vertices = std::move(other.vertices);
 		this->indices = std::move(other.indices);
+		this->indexType = other.indexType;
 		this->atts = std::move(other.atts);
+		this->packed = other.packed;
+		this->packedVertices = std::move(other.packedVertices);
+		this->positionOffset = other.positionOffset;
+		this->positionScale = other.positionScale;
 
 		return *this;
 	}
@@ -130,7 +203,17 @@ public:
 
 	std::vector<Vertex> vertices;
 	std::vector<Index> indices;
+	//type of the GPU index buffer: GL_UNSIGNED_SHORT if the mesh has fewer than 0xFFFF vertices, GL_UNSIGNED_INT otherwise.
+	//indices stay 32 bit on the CPU side and are narrowed by OBJLoader::uploadIndices. Pass it to glDrawElements.
+	GLenum indexType;
 	std::vector<VertexAttribute> atts;
+
+	//set by VertexQuantizer::quantize: packedVertices and atts hold the upload data instead of vertices.
+	//position = positionOffset + positionScale * position / 65535: offset is the bounding box minimum, scale its extent
+	bool packed;
+	std::vector<PackedVertex> packedVertices;
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
 };
 
 class OBJObject
@@ -219,6 +302,23 @@ private:
 
 public:
 	static OBJResult loadOBJ(const std::string& objpath, bool calcnormals = false, bool calctangents = false);
+	//memory maps the file and parses it in place. Produces the same result as loadOBJ.
+	//The file is split at line boundaries into chunks that are parsed by up to "threads" worker threads
+	//(0: one per hardware thread) and merged in file order afterwards.
+	static OBJResult loadOBJMapped(const std::string& objpath, bool calcnormals = false, bool calctangents = false, unsigned int threads = 1);
+	//loads from the binary cache "<objpath>.vcmesh" if it is up to date, otherwise parses the file with loadOBJMapped
+	//and writes the cache for the next start. compressindices writes the indices delta varint encoded (smaller file,
+	//slower load, see MeshCache::write). Caches in either encoding are read.
+	static OBJResult loadOBJCached(const std::string& objpath, bool calcnormals = false, bool calctangents = false, unsigned int threads = 1, bool compressindices = false);
+
+	//called by streamOBJ for every finished mesh. The mesh may be moved from.
+	typedef std::function<void(const std::string& objectname, OBJMesh& mesh)> MeshCallback;
+	//Streams the file mesh by mesh instead of building an OBJResult, for files that don't fit into memory.
+	//memorylimit bounds the parsed v/vt/vn data kept in memory and the size of the mesh under construction.
+	//Vertex data is read from the mapped file on demand, a mesh that would exceed the limit is passed to
+	//the callback in several consecutive parts with the same name (normals/tangents are calculated per part).
+	//Not included in the limit: the mapping itself and an index of about 0.2 bytes per v/vt/vn line.
+	static void streamOBJ(const std::string& objpath, const MeshCallback& callback, size_t memorylimit = 256u << 20, bool calcnormals = false, bool calctangents = false);
 
 	class DataCache
 	{
@@ -234,10 +334,20 @@ public:
 		//if -1: undefined
 		Index p_idx = 0;
 		bool p_defined = false;
+		bool p_relative = false;	//negative index in the file, resolved against the data parsed so far
 		Index uv_idx = 0;
 		bool uv_defined = false;
+		bool uv_relative = false;
 		Index n_idx = 0;
 		bool n_defined = false;
+		bool n_relative = false;
+
+		//key for VertexHashTable
+		VertexKey key() const
+		{
+			return VertexKey{ p_idx, uv_idx, n_idx,
+				static_cast<uint32_t>(p_defined) | (static_cast<uint32_t>(uv_defined) << 1) | (static_cast<uint32_t>(n_defined) << 2) };
+		}
 
 		class hash
 		{
@@ -249,6 +359,7 @@ public:
 				seed ^= h(vd.p_idx) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 				seed ^= h(vd.uv_idx) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 				seed ^= h(vd.n_idx) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+				seed ^= h(vd.p_defined | (vd.uv_defined << 1) | (vd.n_defined << 2)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 				return seed;
 			}
 			//seed ^= hash_value(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
@@ -259,16 +370,41 @@ public:
 		public:
 			bool operator()(const VertexDef& vd1, const VertexDef& vd2) const
 			{
-				return (vd1.p_idx == vd2.p_idx && vd1.uv_idx == vd2.uv_idx && vd1.n_idx == vd2.n_idx);
+				return (vd1.p_idx == vd2.p_idx && vd1.uv_idx == vd2.uv_idx && vd1.n_idx == vd2.n_idx &&
+					vd1.p_defined == vd2.p_defined && vd1.uv_defined == vd2.uv_defined && vd1.n_defined == vd2.n_defined);
 			}
 		};
 		
 	};
 
-	class Face
+	//parsed content of one line aligned part of a mapped file
+	class Chunk
 	{
 	public:
-		std::vector<VertexDef> verts;
+		enum class RecordType : unsigned char
+		{
+			Data,		//first v, vt or vn of the chunk
+			Faces,		//run of consecutive faces
+			Object,		//o
+			Group		//g
+		};
+
+		class Record
+		{
+		public:
+			RecordType type;
+			size_t first;		//Faces: first triangle, Object/Group: index into names
+			size_t count;		//Faces: number of triangles
+			//number of v, vt, vn parsed in this chunk before this record
+			size_t positions;
+			size_t uvs;
+			size_t normals;
+		};
+
+		DataCache data;
+		std::vector<VertexDef> faceverts;	//3 per triangle. Relative indices are resolved against the chunk's own data.
+		std::vector<std::string> names;
+		std::vector<Record> records;
 	};
 
 private:
@@ -286,22 +422,138 @@ private:
 	//parse f flags and call parseFace
 	static OBJMesh parseMesh(DataCache& cache ,std::ifstream& stream, bool calcnormals = false, bool calctangents = false);
 
-	//parse face and generate vertices and indices for the mesh
-	static Face parseFace(std::ifstream& stream);
+	//parse face and append its fan triangulation to triangles (3 VertexDefs per triangle)
+	static void parseFace(std::ifstream& stream, const DataCache& cache, std::vector<VertexDef>& triangles);
+
+	//create Vertex from "v/vt/vn" strings. Negative indices count back from npositions/nuvs/nnormals.
+	static VertexDef parseVertex(const char* begin, const char* end, size_t npositions, size_t nuvs, size_t nnormals);
+	//adds vert to the fan of the face. count is the number of vertices of the face so far.
+	static void addFaceVertex(const VertexDef& vert, size_t& count, VertexDef& first, VertexDef& prev, std::vector<VertexDef>& triangles);
+
+	//in memory counterparts of the stream parsing helpers above
+	static glm::vec3 parsePosition(memscanhelper::Cursor& cursor);
+	static glm::vec3 parseNormal(memscanhelper::Cursor& cursor);
+	static glm::vec2 parseUV(memscanhelper::Cursor& cursor);
+	static void parseFace(memscanhelper::Cursor& cursor, size_t npositions, size_t nuvs, size_t nnormals, std::vector<VertexDef>& triangles);
+
+	//chunked parsing
+	//state of the object/group structure while the chunks are merged in file order
+	class AssemblyState
+	{
+	public:
+		OBJResult* result = nullptr;
+		bool objectOpen = false;
+		bool meshOpen = false;
+		OBJMesh mesh;
+		VertexHashTable meshvertset;
+		std::vector<VertexDef> meshverts;
+		std::vector<Index> meshindices;
+	};
+
+	//parse all v, vt, vn, f, o and g records of [begin, end). Thread safe.
+	static Chunk scanChunk(const char* begin, const char* end);
+	//replay the records of a chunk. cache must already hold the data of all chunks up to and including this one.
+	static void assembleChunk(AssemblyState& state, DataCache& cache, const Chunk& chunk, size_t pbase, size_t uvbase, size_t nbase);
+	static void openObject(AssemblyState& state, const std::string& name);
+	static void openMesh(AssemblyState& state, const std::string& name);
+	static void closeMesh(AssemblyState& state, DataCache& cache, size_t plimit, size_t uvlimit, size_t nlimit);
+
+	//streaming
+	//On demand access to the v, vt or vn lines of a mapped file. Only the start of every BLOCK_SIZE-th line is kept,
+	//blocks are parsed when they are needed and cached in a fixed number of slots (clock replacement).
+	template <typename T>
+	class DataBlockCache
+	{
+	public:
+		static const size_t BLOCK_SIZE = 64;
+		typedef T(*ParseFunc)(memscanhelper::Cursor& cursor);
+
+		DataBlockCache(const char* command, ParseFunc parse, const char* end, size_t maxbytes);
 
-	//create Vertex from "v/vt/vn" strings
-	static VertexDef parseVertex(const std::string& vstring);
+		//line holds the next element
+		void add(const char* line);
+		size_t size() const
+		{
+			return m_count;
+		}
+		//false if i is out of range
+		bool get(size_t i, T& out);
+
+	private:
+		static const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+		void load(size_t block, size_t slot);
+
+		const char* m_command;
+		ParseFunc m_parse;
+		const char* m_end;
+		size_t m_maxSlots;
+		size_t m_count;
+		std::vector<const char*> m_blockStarts;
+		std::vector<uint32_t> m_blockSlots;		//per block: cache slot or NO_SLOT
+		std::vector<T> m_slotData;				//BLOCK_SIZE elements per slot
+		std::vector<size_t> m_slotBlocks;
+		std::vector<size_t> m_slotValid;		//elements of the block that were known when it was loaded
+		std::vector<unsigned char> m_slotUsed;
+		size_t m_hand;
+	};
+
+	//vertex data of a streamed file
+	class StreamData
+	{
+	public:
+		StreamData(const char* end, size_t maxbytes);
+
+		DataBlockCache<glm::vec3> positions;
+		DataBlockCache<glm::vec2> uvs;
+		DataBlockCache<glm::vec3> normals;
+
+		bool position(Index i, glm::vec3& out) { return positions.get(i, out); }
+		bool uv(Index i, glm::vec2& out) { return uvs.get(i, out); }
+		bool normal(Index i, glm::vec3& out) { return normals.get(i, out); }
+	};
+
+	//only the first plimit/uvlimit/nlimit entries of the cache are visible
+	class CacheView
+	{
+	public:
+		const DataCache& cache;
+		size_t plimit;
+		size_t uvlimit;
+		size_t nlimit;
+
+		bool position(Index i, glm::vec3& out) const;
+		bool uv(Index i, glm::vec2& out) const;
+		bool normal(Index i, glm::vec3& out) const;
+	};
 
 	//fill mesh
-	static void fillMesh(OBJMesh& mesh, DataCache& cache, std::vector<VertexDef> vdefs, std::vector<Index>& indices);
+	static void fillMesh(OBJMesh& mesh, DataCache& cache, const std::vector<VertexDef>& vdefs, std::vector<Index>& indices);
+	//only the first plimit/uvlimit/nlimit entries of the cache are visible to the mesh
+	static void fillMesh(OBJMesh& mesh, DataCache& cache, const std::vector<VertexDef>& vdefs, std::vector<Index>& indices, size_t plimit, size_t uvlimit, size_t nlimit);
+	//Data: CacheView or StreamData
+	template <typename Data>
+	static void fillMeshFrom(OBJMesh& mesh, Data& data, const std::vector<VertexDef>& vdefs, std::vector<Index>& indices);
+	//position, uv, normal and tangent attributes of Vertex
+	static void addVertexAttributes(OBJMesh& mesh);
 
 
 
 public:
 	//post processing
-	static void recalculateNormals(OBJMesh& mesh);
-	static void recalculateTangents(OBJMesh& mesh);
+	//With more than one thread (0: one per hardware thread) every thread
+	//accumulates its share of the triangles into its own buffer (12 bytes per vertex), the buffers are summed per vertex range.
+	//The multi threaded result differs from the single threaded one only by float rounding.
+	static void recalculateNormals(OBJMesh& mesh, unsigned int threads = 1);
+	static void recalculateTangents(OBJMesh& mesh, unsigned int threads = 1);
 	static void reverseWinding(OBJMesh& mesh);
+
+	//index buffer helpers
+	//smallest index type for vertexcount vertices (0xFFFF stays free as primitive restart index)
+	static GLenum selectIndexType(size_t vertexcount);
+	static size_t getIndexSize(GLenum type);
+	//glBufferData with mesh.indices converted to mesh.indexType
+	static void uploadIndices(const OBJMesh& mesh, GLenum target = GL_ELEMENT_ARRAY_BUFFER, GLenum usage = GL_STATIC_DRAW);
 };
 
 
@@ -0,0 +1,64 @@
+#include "VertexHashTable.h"
+#include <algorithm>
+
+const size_t VertexHashTable::GROUP_SIZE;
+const int8_t VertexHashTable::EMPTY;
+
+VertexHashTable::VertexHashTable() :
+	m_groupMask(0),
+	m_size(0),
+	m_growthLimit(0)
+{
+	rehash(1);
+}
+
+void VertexHashTable::reserve(size_t count)
+{
+	if (count <= m_growthLimit)
+		return;
+	size_t groups = m_groupMask + 1;
+	while (groups * GROUP_SIZE * 7 / 8 < count)
+		groups *= 2;
+	rehash(groups);
+}
+
+void VertexHashTable::clear()
+{
+	std::fill(m_ctrl.begin(), m_ctrl.end(), EMPTY);
+	m_size = 0;
+}
+
+void VertexHashTable::rehash(size_t groups)
+{
+	std::vector<int8_t> oldctrl(groups * GROUP_SIZE, EMPTY);
+	std::vector<Slot> oldslots(groups * GROUP_SIZE);
+	oldctrl.swap(m_ctrl);
+	oldslots.swap(m_slots);
+
+	m_groupMask = groups - 1;
+	m_growthLimit = groups * GROUP_SIZE * 7 / 8;	//max load factor 7/8
+
+	for (size_t i = 0; i < oldctrl.size(); i++)
+	{
+		if (oldctrl[i] != EMPTY)
+			insertNew(oldslots[i].key, oldslots[i].value, hash(oldslots[i].key));
+	}
+}
+
+void VertexHashTable::insertNew(const VertexKey & key, Index value, uint64_t h)
+{
+	size_t group = static_cast<size_t>(h >> 7) & m_groupMask;
+	for (size_t step = 1;; step++)
+	{
+		uint32_t empty = match(&m_ctrl[group * GROUP_SIZE], EMPTY);
+		if (empty)
+		{
+			size_t slot = group * GROUP_SIZE + lowestBit(empty);
+			m_ctrl[slot] = static_cast<int8_t>(h & 0x7F);
+			m_slots[slot].key = key;
+			m_slots[slot].value = value;
+			return;
+		}
+		group = (group + step) & m_groupMask;
+	}
+}
@@ -0,0 +1,147 @@
+#ifndef _VERTEX_HASH_TABLE_H_
+#define _VERTEX_HASH_TABLE_H_
+#include <CommonTypes.h>
+#include <fw_config.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef VC_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//packed (position, uv, normal) index triple of an OBJ face vertex
+struct VertexKey
+{
+	uint32_t p;
+	uint32_t uv;
+	uint32_t n;
+	uint32_t defined;	//bit 0: p, bit 1: uv, bit 2: n
+
+	bool operator==(const VertexKey& other) const
+	{
+		return p == other.p && uv == other.uv && n == other.n && defined == other.defined;
+	}
+};
+
+//Open addressing hash map VertexKey -> Index used to deduplicate face vertices.
+//Slots are organized in groups of 16. Each slot has a control byte holding 7 bits of the hash (or EMPTY),
+//so one group is probed with a single 16 byte compare (SSE2) before any key is touched.
+//Entries can't be removed, only the whole table can be cleared.
+class VertexHashTable
+{
+public:
+	VertexHashTable();
+
+	//make room for count entries without rehashing
+	void reserve(size_t count);
+	void clear();
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	//returns the value stored for key. If key is not present, value is inserted and returned.
+	inline Index findOrInsert(const VertexKey& key, Index value);
+
+private:
+	static const size_t GROUP_SIZE = 16;
+	static const int8_t EMPTY = -128;
+
+	struct Slot
+	{
+		VertexKey key;
+		Index value;
+	};
+
+	std::vector<int8_t> m_ctrl;
+	std::vector<Slot> m_slots;
+	size_t m_groupMask;
+	size_t m_size;
+	size_t m_growthLimit;
+
+	static uint64_t hash(const VertexKey& key)
+	{
+		uint64_t h = (static_cast<uint64_t>(key.p) | (static_cast<uint64_t>(key.defined) << 32)) * 0x9E3779B97F4A7C15ull;
+		h ^= (static_cast<uint64_t>(key.uv) | (static_cast<uint64_t>(key.n) << 32)) * 0xC2B2AE3D27D4EB4Full;
+		h ^= h >> 29;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 32;
+		return h;
+	}
+
+	//bit i set: control byte i of the group equals tag
+	static uint32_t match(const int8_t* group, int8_t tag)
+	{
+#ifdef VC_SSE2
+		__m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag))));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < GROUP_SIZE; i++)
+			mask |= static_cast<uint32_t>(group[i] == tag) << i;
+		return mask;
+#endif
+	}
+
+	//mask must not be 0
+	static int lowestBit(uint32_t mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long i;
+		_BitScanForward(&i, mask);
+		return static_cast<int>(i);
+#elif defined(__GNUC__)
+		return __builtin_ctz(mask);
+#else
+		int i = 0;
+		while (!(mask & 1u))
+		{
+			mask >>= 1;
+			i++;
+		}
+		return i;
+#endif
+	}
+
+	void rehash(size_t groups);
+	void insertNew(const VertexKey& key, Index value, uint64_t h);
+};
+
+inline Index VertexHashTable::findOrInsert(const VertexKey & key, Index value)
+{
+	if (m_size >= m_growthLimit)
+		rehash((m_groupMask + 1) * 2);
+
+	uint64_t h = hash(key);
+	int8_t tag = static_cast<int8_t>(h & 0x7F);
+	size_t group = static_cast<size_t>(h >> 7) & m_groupMask;
+	for (size_t step = 1;; step++)
+	{
+		const int8_t* ctrl = &m_ctrl[group * GROUP_SIZE];
+		for (uint32_t candidates = match(ctrl, tag); candidates; candidates &= candidates - 1)
+		{
+			size_t slot = group * GROUP_SIZE + lowestBit(candidates);
+			if (m_slots[slot].key == key)
+				return m_slots[slot].value;
+		}
+		uint32_t empty = match(ctrl, EMPTY);
+		if (empty)
+		{
+			//no deletions: the key would have been found before the first empty slot
+			size_t slot = group * GROUP_SIZE + lowestBit(empty);
+			m_ctrl[slot] = tag;
+			m_slots[slot].key = key;
+			m_slots[slot].value = value;
+			m_size++;
+			return value;
+		}
+		group = (group + step) & m_groupMask;	//triangular probing visits every group
+	}
+}
+
+#endif
@@ -0,0 +1,166 @@
+#include "VertexQuantizer.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace
+{
+	float snormToFloat(int value, int maxvalue)
+	{
+		return std::max(static_cast<float>(value) / static_cast<float>(maxvalue), -1.0f);
+	}
+
+	//octahedral snorm encoding. All four roundings of the two components are tried and the one that decodes
+	//closest to n is kept, which matters most for the 8 bit tangents.
+	template <typename T>
+	void encodeDirection(const glm::vec3& n, int maxvalue, T out[2])
+	{
+		float length = glm::length(n);
+		if (!(length > 0.0f))
+		{
+			//undefined direction (i.e. no normals in the file): encode +z
+			out[0] = 0;
+			out[1] = 0;
+			return;
+		}
+		glm::vec3 dir = n / length;
+		glm::vec2 e = VertexQuantizer::octEncode(dir) * static_cast<float>(maxvalue);
+		float best = -2.0f;
+		for (int i = 0; i < 4; i++)
+		{
+			int x = static_cast<int>((i & 1) ? std::ceil(e.x) : std::floor(e.x));
+			int y = static_cast<int>((i & 2) ? std::ceil(e.y) : std::floor(e.y));
+			x = std::min(std::max(x, -maxvalue), maxvalue);
+			y = std::min(std::max(y, -maxvalue), maxvalue);
+			float d = glm::dot(dir, VertexQuantizer::octDecode(glm::vec2(snormToFloat(x, maxvalue), snormToFloat(y, maxvalue))));
+			if (d > best)
+			{
+				best = d;
+				out[0] = static_cast<T>(x);
+				out[1] = static_cast<T>(y);
+			}
+		}
+	}
+
+	float angleDegrees(const glm::vec3& a, const glm::vec3& b)
+	{
+		//atan2 stays accurate for tiny angles, unlike acos
+		if (!(glm::length(a) > 0.0f && glm::length(b) > 0.0f))
+			return 0.0f;
+		return glm::degrees(std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+	}
+}
+
+void VertexQuantizer::quantize(OBJMesh & mesh, Error * error, bool keepvertices)
+{
+	try
+	{
+		//bounding box
+		glm::vec3 minpos(0.0f), maxpos(0.0f);
+		if (!mesh.vertices.empty())
+		{
+			minpos = maxpos = mesh.vertices[0].position;
+			for (const auto& v : mesh.vertices)
+			{
+				minpos = glm::min(minpos, v.position);
+				maxpos = glm::max(maxpos, v.position);
+			}
+		}
+		mesh.positionOffset = minpos;
+		mesh.positionScale = maxpos - minpos;
+		glm::vec3 invscale(0.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			if (mesh.positionScale[i] > 0.0f)
+				invscale[i] = 65535.0f / mesh.positionScale[i];
+		}
+
+		mesh.packedVertices.resize(mesh.vertices.size());
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			const Vertex& v = mesh.vertices[i];
+			PackedVertex& p = mesh.packedVertices[i];
+			for (int c = 0; c < 3; c++)
+			{
+				float q = std::floor((v.position[c] - minpos[c]) * invscale[c] + 0.5f);
+				p.position[c] = static_cast<GLushort>(std::min(std::max(q, 0.0f), 65535.0f));
+			}
+			encodeDirection(v.normal, 32767, p.normal);
+			encodeDirection(v.tangent, 127, p.tangent);
+			p.uv[0] = glm::packHalf1x16(v.uv.x);
+			p.uv[1] = glm::packHalf1x16(v.uv.y);
+		}
+		mesh.packed = true;
+
+		if (error)
+		{
+			*error = Error();
+			for (size_t i = 0; i < mesh.vertices.size(); i++)
+			{
+				const Vertex& v = mesh.vertices[i];
+				Vertex d = dequantize(mesh, mesh.packedVertices[i]);
+				error->position = std::max(error->position, glm::length(d.position - v.position));
+				if (mesh.hasNormals)
+					error->normal = std::max(error->normal, angleDegrees(d.normal, v.normal));
+				if (mesh.hasTangents)
+					error->tangent = std::max(error->tangent, angleDegrees(d.tangent, v.tangent));
+				if (mesh.hasUVs)
+				{
+					error->uv = std::max(error->uv, std::abs(d.uv.x - v.uv.x));
+					error->uv = std::max(error->uv, std::abs(d.uv.y - v.uv.y));
+				}
+			}
+		}
+
+		mesh.atts.clear();
+		addPackedAttributes(mesh.atts);
+		if (!keepvertices)
+			std::vector<Vertex>().swap(mesh.vertices);
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+Vertex VertexQuantizer::dequantize(const OBJMesh & mesh, const PackedVertex & vertex)
+{
+	Vertex v;
+	//same as the normalized attribute: unorm16 to [0, 1]
+	v.position = mesh.positionOffset + mesh.positionScale *
+		(glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]) / 65535.0f);
+	v.uv = glm::vec2(glm::unpackHalf1x16(vertex.uv[0]), glm::unpackHalf1x16(vertex.uv[1]));
+	v.normal = octDecode(glm::vec2(snormToFloat(vertex.normal[0], 32767), snormToFloat(vertex.normal[1], 32767)));
+	v.tangent = octDecode(glm::vec2(snormToFloat(vertex.tangent[0], 127), snormToFloat(vertex.tangent[1], 127)));
+	return v;
+}
+
+glm::vec2 VertexQuantizer::octEncode(const glm::vec3 & n)
+{
+	//project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals
+	glm::vec3 p = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+	if (p.z < 0.0f)
+	{
+		return glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+	}
+	return glm::vec2(p.x, p.y);
+}
+
+glm::vec3 VertexQuantizer::octDecode(const glm::vec2 & e)
+{
+	glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+void VertexQuantizer::addPackedAttributes(std::vector<VertexAttribute>& atts)
+{
+	atts.push_back(VertexAttribute{3, GL_UNSIGNED_SHORT, sizeof(PackedVertex), offsetof(PackedVertex, position), GL_TRUE});
+	atts.push_back(VertexAttribute{2, GL_HALF_FLOAT, sizeof(PackedVertex), offsetof(PackedVertex, uv), GL_FALSE});
+	atts.push_back(VertexAttribute{2, GL_SHORT, sizeof(PackedVertex), offsetof(PackedVertex, normal), GL_TRUE});
+	atts.push_back(VertexAttribute{2, GL_BYTE, sizeof(PackedVertex), offsetof(PackedVertex, tangent), GL_TRUE});
+}
@@ -0,0 +1,46 @@
+#ifndef _VERTEX_QUANTIZER_H_
+#define _VERTEX_QUANTIZER_H_
+#include <OBJLoader.h>
+
+//Converts the 44 byte float vertices of an OBJMesh into 16 byte PackedVertex.
+//	position:	3 x unorm16 relative to the bounding box of the mesh
+//	normal:		octahedral encoding, 2 x snorm16
+//	tangent:	octahedral encoding, 2 x snorm8
+//	uv:			2 x half float
+//
+//Decoding in a vertex shader (normalized attributes arrive as floats, inPosition in [0, 1]):
+//	position = positionOffset + positionScale * inPosition;
+//	vec3 octDecode(vec2 e) { vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y)); float t = max(-n.z, 0.0);
+//		n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t); return normalize(n); }
+class VertexQuantizer
+{
+private:
+	VertexQuantizer();
+	~VertexQuantizer();
+
+public:
+	//largest deviation of the decoded data from the float input
+	class Error
+	{
+	public:
+		float position = 0.0f;	//distance in object space units
+		float normal = 0.0f;	//angle in degrees
+		float tangent = 0.0f;	//angle in degrees
+		float uv = 0.0f;		//absolute per component
+	};
+
+	//Fills mesh.packedVertices and replaces mesh.atts with the packed layout.
+	//mesh.vertices is released unless keepvertices is set. Run MeshOptimizer before, it rejects packed meshes.
+	static void quantize(OBJMesh& mesh, Error* error = nullptr, bool keepvertices = false);
+	//CPU side decoding of a packed vertex of mesh
+	static Vertex dequantize(const OBJMesh& mesh, const PackedVertex& vertex);
+
+	//octahedral mapping of unit vectors to [-1, 1]^2
+	static glm::vec2 octEncode(const glm::vec3& n);
+	static glm::vec3 octDecode(const glm::vec2& e);
+
+	//attribute layout of PackedVertex, in the same order as the float layout (position, uv, normal, tangent)
+	static void addPackedAttributes(std::vector<VertexAttribute>& atts);
+};
+
+#endif
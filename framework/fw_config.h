@@ -12,4 +12,9 @@
 #define LOG_PERF 0						//log perf data
 #define NUM_RESERVED_PERF_RECORDS 1e6	//reserved memory
 
+//SSE2 code paths (include <emmintrin.h> where used), scalar code otherwise
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VC_SSE2
+#endif
+
 #endif
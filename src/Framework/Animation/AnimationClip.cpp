@@ -0,0 +1,115 @@
+#include "AnimationClip.h"
+#include <algorithm>
+
+AnimationClip::AnimationClip(const std::string & name, float duration, uint32_t jointCount, bool looping) :
+	m_name(name),
+	m_duration(duration),
+	m_jointCount(jointCount),
+	m_looping(looping),
+	m_positions(jointCount),
+	m_rotations(jointCount),
+	m_scales(jointCount)
+{
+	if (duration <= 0.0f)
+		throw std::logic_error("Animation clip " + name + " needs a positive duration.");
+}
+
+template <typename T>
+void AnimationClip::addKey(Track<T>& track, float time, const T & value)
+{
+	if (!track.times.empty() && time <= track.times.back())
+		throw std::logic_error("Animation keys have to be added in increasing time order.");
+	track.times.push_back(time);
+	track.values.push_back(value);
+}
+
+void AnimationClip::addPositionKey(uint32_t joint, float time, const glm::vec3 & position)
+{
+	if (joint >= m_jointCount)
+		throw std::logic_error("Invalid joint index in animation clip " + m_name + ".");
+	addKey(m_positions[joint], time, position);
+}
+
+void AnimationClip::addRotationKey(uint32_t joint, float time, const glm::quat & rotation)
+{
+	if (joint >= m_jointCount)
+		throw std::logic_error("Invalid joint index in animation clip " + m_name + ".");
+	addKey(m_rotations[joint], time, glm::normalize(rotation));
+}
+
+void AnimationClip::addScaleKey(uint32_t joint, float time, const glm::vec3 & scale)
+{
+	if (joint >= m_jointCount)
+		throw std::logic_error("Invalid joint index in animation clip " + m_name + ".");
+	addKey(m_scales[joint], time, scale);
+}
+
+uint32_t AnimationClip::findKey(const std::vector<float>& times, float time, uint32_t hint)
+{
+	uint32_t count = static_cast<uint32_t>(times.size());
+	//cached key or the one after it: the common case when playing forward
+	if (hint < count && times[hint] <= time)
+	{
+		if (hint + 1 >= count || time < times[hint + 1])
+			return hint;
+		if (hint + 2 >= count || time < times[hint + 2])
+			return hint + 1;
+	}
+	uint32_t upper = static_cast<uint32_t>(std::upper_bound(times.begin(), times.end(), time) - times.begin());
+	return upper > 0 ? upper - 1 : 0;
+}
+
+float AnimationClip::keyFactor(const std::vector<float>& times, uint32_t key, float time)
+{
+	if (key + 1 >= times.size() || time <= times[key])
+		return 0.0f;
+	return std::min((time - times[key]) / (times[key + 1] - times[key]), 1.0f);
+}
+
+void AnimationClip::sample(float time, JointPose * pose, uint32_t * cursor) const
+{
+	for (uint32_t j = 0; j < m_jointCount; j++)
+	{
+		const Track<glm::vec3>& positions = m_positions[j];
+		if (!positions.times.empty())
+		{
+			uint32_t key = findKey(positions.times, time, cursor ? cursor[j * 3] : 0);
+			float f = keyFactor(positions.times, key, time);
+			pose[j].position = f > 0.0f ? glm::mix(positions.values[key], positions.values[key + 1], f) : positions.values[key];
+			if (cursor)
+				cursor[j * 3] = key;
+		}
+		else
+		{
+			pose[j].position = glm::vec3(0.0f);
+		}
+
+		const Track<glm::quat>& rotations = m_rotations[j];
+		if (!rotations.times.empty())
+		{
+			uint32_t key = findKey(rotations.times, time, cursor ? cursor[j * 3 + 1] : 0);
+			float f = keyFactor(rotations.times, key, time);
+			pose[j].rotation = f > 0.0f ? glm::slerp(rotations.values[key], rotations.values[key + 1], f) : rotations.values[key];
+			if (cursor)
+				cursor[j * 3 + 1] = key;
+		}
+		else
+		{
+			pose[j].rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		}
+
+		const Track<glm::vec3>& scales = m_scales[j];
+		if (!scales.times.empty())
+		{
+			uint32_t key = findKey(scales.times, time, cursor ? cursor[j * 3 + 2] : 0);
+			float f = keyFactor(scales.times, key, time);
+			pose[j].scale = f > 0.0f ? glm::mix(scales.values[key], scales.values[key + 1], f) : scales.values[key];
+			if (cursor)
+				cursor[j * 3 + 2] = key;
+		}
+		else
+		{
+			pose[j].scale = glm::vec3(1.0f);
+		}
+	}
+}
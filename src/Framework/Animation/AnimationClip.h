@@ -0,0 +1,97 @@
+#ifndef _ANIMATION_CLIP_H_
+#define _ANIMATION_CLIP_H_
+#include <libheaders.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+//local position / rotation / scale of one joint
+struct JointPose
+{
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+
+	JointPose() :
+		position(0.0f),
+		rotation(1.0f, 0.0f, 0.0f, 0.0f),
+		scale(1.0f)
+	{}
+
+	//translate * rotate * scale, like Transform::getMatrix
+	glm::mat4 toMatrix() const
+	{
+		glm::mat4 m = glm::toMat4(rotation);
+		m[0] *= scale.x;
+		m[1] *= scale.y;
+		m[2] *= scale.z;
+		m[3] = glm::vec4(position, 1.0f);
+		return m;
+	}
+};
+
+//Keyframed position / rotation / scale tracks for a fixed number of joints.
+//Positions and scales are interpolated linearly, rotations with slerp. A track without keys gives the
+//identity value, a track with one key is constant. Times outside the keys clamp to the first / last key.
+class AnimationClip
+{
+public:
+	AnimationClip(const std::string& name, float duration, uint32_t jointCount, bool looping = true);
+
+	//keys of a track have to be added in increasing time order
+	void addPositionKey(uint32_t joint, float time, const glm::vec3& position);
+	void addRotationKey(uint32_t joint, float time, const glm::quat& rotation);
+	void addScaleKey(uint32_t joint, float time, const glm::vec3& scale);
+
+	//Writes getJointCount() poses.
+	//cursor: optional key index per track (getCursorSize() entries) from the last sample. Playing forward, the key
+	//is found by checking the cached and the next key, only jumps fall back to a binary search.
+	void sample(float time, JointPose* pose, uint32_t* cursor = nullptr) const;
+
+	const std::string& getName() const
+	{
+		return m_name;
+	}
+	float getDuration() const
+	{
+		return m_duration;
+	}
+	bool isLooping() const
+	{
+		return m_looping;
+	}
+	uint32_t getJointCount() const
+	{
+		return m_jointCount;
+	}
+	size_t getCursorSize() const
+	{
+		return m_jointCount * 3;
+	}
+
+private:
+	template <typename T>
+	struct Track
+	{
+		std::vector<float> times;
+		std::vector<T> values;
+	};
+
+	std::string m_name;
+	float m_duration;
+	uint32_t m_jointCount;
+	bool m_looping;
+	std::vector<Track<glm::vec3>> m_positions;
+	std::vector<Track<glm::quat>> m_rotations;
+	std::vector<Track<glm::vec3>> m_scales;
+
+	template <typename T>
+	static void addKey(Track<T>& track, float time, const T& value);
+	//index of the last key at or before time, 0 before the first key
+	static uint32_t findKey(const std::vector<float>& times, float time, uint32_t hint);
+	//interpolation factor between key and key + 1
+	static float keyFactor(const std::vector<float>& times, uint32_t key, float time);
+};
+
+#endif
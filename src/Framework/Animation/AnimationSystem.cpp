@@ -0,0 +1,144 @@
+#include "AnimationSystem.h"
+#include <cmath>
+#include <algorithm>
+
+AnimationSystem::AnimationSystem(uint32_t jointCount) :
+	m_jointCount(jointCount),
+	m_scratch(jointCount),
+	m_sampleBudget(0),
+	m_nextSample(0),
+	m_sampled(0)
+{}
+
+void AnimationSystem::checkInstance(InstanceId instance) const
+{
+	if (instance >= m_clip.size())
+		throw std::logic_error("Invalid animation instance.");
+}
+
+AnimationSystem::InstanceId AnimationSystem::createInstance(const AnimationClip * clip, float time)
+{
+	if (!clip || clip->getJointCount() != m_jointCount)
+		throw std::logic_error("Animation clip doesn't match the joint count of the animation system.");
+	InstanceId instance = static_cast<InstanceId>(m_clip.size());
+	m_clip.push_back(clip);
+	m_time.push_back(advance(clip, 0.0f, time));
+	m_fadeClip.push_back(nullptr);
+	m_fadeTime.push_back(0.0f);
+	m_fadeElapsed.push_back(0.0f);
+	m_fadeDuration.push_back(0.0f);
+	m_speed.push_back(1.0f);
+	m_cursor.resize(m_cursor.size() + 2 * m_jointCount * 3, 0);
+	m_poses.resize(m_poses.size() + m_jointCount);
+	clip->sample(m_time[instance], &m_poses[instance * m_jointCount], cursor(instance, 0));
+	return instance;
+}
+
+void AnimationSystem::play(InstanceId instance, const AnimationClip * clip, float fadeDuration, bool sync)
+{
+	checkInstance(instance);
+	if (!clip || clip->getJointCount() != m_jointCount)
+		throw std::logic_error("Animation clip doesn't match the joint count of the animation system.");
+	float time = sync ? m_time[instance] / m_clip[instance]->getDuration() * clip->getDuration() : 0.0f;
+	if (fadeDuration > 0.0f)
+	{
+		//the current clip becomes the one faded out, its cursor moves along
+		m_fadeClip[instance] = m_clip[instance];
+		m_fadeTime[instance] = m_time[instance];
+		m_fadeElapsed[instance] = 0.0f;
+		m_fadeDuration[instance] = fadeDuration;
+		std::copy(cursor(instance, 0), cursor(instance, 0) + m_jointCount * 3, cursor(instance, 1));
+	}
+	else
+	{
+		m_fadeClip[instance] = nullptr;
+	}
+	m_clip[instance] = clip;
+	m_time[instance] = time;
+}
+
+void AnimationSystem::setSpeed(InstanceId instance, float speed)
+{
+	checkInstance(instance);
+	m_speed[instance] = speed;
+}
+
+void AnimationSystem::setTime(InstanceId instance, float time)
+{
+	checkInstance(instance);
+	m_time[instance] = advance(m_clip[instance], 0.0f, time);
+}
+
+float AnimationSystem::getTime(InstanceId instance) const
+{
+	checkInstance(instance);
+	return m_time[instance];
+}
+
+const AnimationClip * AnimationSystem::getClip(InstanceId instance) const
+{
+	checkInstance(instance);
+	return m_clip[instance];
+}
+
+float AnimationSystem::advance(const AnimationClip * clip, float time, float dt)
+{
+	time += dt;
+	float duration = clip->getDuration();
+	if (clip->isLooping())
+	{
+		time = std::fmod(time, duration);
+		if (time < 0.0f)
+			time += duration;
+		return time;
+	}
+	return std::min(std::max(time, 0.0f), duration);
+}
+
+void AnimationSystem::update(float dt)
+{
+	size_t count = m_clip.size();
+	//clocks are cheap, they always run
+	for (size_t i = 0; i < count; i++)
+	{
+		float step = dt * m_speed[i];
+		m_time[i] = advance(m_clip[i], m_time[i], step);
+		if (m_fadeClip[i])
+		{
+			m_fadeTime[i] = advance(m_fadeClip[i], m_fadeTime[i], step);
+			m_fadeElapsed[i] += dt;
+			if (m_fadeElapsed[i] >= m_fadeDuration[i])
+				m_fadeClip[i] = nullptr;
+		}
+	}
+
+	size_t samples = m_sampleBudget == 0 ? count : std::min(m_sampleBudget, count);
+	for (size_t s = 0; s < samples; s++)
+	{
+		if (m_nextSample >= count)
+			m_nextSample = 0;
+		sampleInstance(static_cast<InstanceId>(m_nextSample++));
+	}
+	m_sampled = samples;
+}
+
+void AnimationSystem::sampleInstance(InstanceId instance)
+{
+	JointPose* pose = &m_poses[instance * m_jointCount];
+	m_clip[instance]->sample(m_time[instance], pose, cursor(instance, 0));
+	if (m_fadeClip[instance])
+	{
+		m_fadeClip[instance]->sample(m_fadeTime[instance], m_scratch.data(), cursor(instance, 1));
+		blend(m_scratch.data(), pose, m_fadeElapsed[instance] / m_fadeDuration[instance], pose, m_jointCount);
+	}
+}
+
+void AnimationSystem::blend(const JointPose * from, const JointPose * to, float weight, JointPose * out, size_t count)
+{
+	for (size_t j = 0; j < count; j++)
+	{
+		out[j].position = glm::mix(from[j].position, to[j].position, weight);
+		out[j].rotation = glm::slerp(from[j].rotation, to[j].rotation, weight);
+		out[j].scale = glm::mix(from[j].scale, to[j].scale, weight);
+	}
+}
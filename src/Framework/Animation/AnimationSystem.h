@@ -0,0 +1,87 @@
+#ifndef _ANIMATION_SYSTEM_H_
+#define _ANIMATION_SYSTEM_H_
+#include "AnimationClip.h"
+#include <vector>
+#include <cstdint>
+
+//Plays clips on many instances of the same rig (same joint count) and samples them in one batch.
+//Every instance has a current clip and, while a crossfade runs, the previous one; both are sampled and blended.
+//Clips are not owned, they have to outlive the system.
+//With a sample budget, update() advances every clock but samples only that many instances, round robin;
+//the others keep their last pose until their turn. That caps the per update cost of large crowds.
+class AnimationSystem
+{
+public:
+	typedef uint32_t InstanceId;
+
+	explicit AnimationSystem(uint32_t jointCount);
+
+	InstanceId createInstance(const AnimationClip* clip, float time = 0.0f);
+	//fadeDuration > 0 crossfades from the current clip.
+	//sync starts the new clip at the same normalized time as the current one (i.e. walk -> run).
+	void play(InstanceId instance, const AnimationClip* clip, float fadeDuration = 0.0f, bool sync = false);
+	void setSpeed(InstanceId instance, float speed);
+	void setTime(InstanceId instance, float time);
+	float getTime(InstanceId instance) const;
+	const AnimationClip* getClip(InstanceId instance) const;
+
+	//instances sampled per update, 0: all
+	void setSampleBudget(size_t maxInstances)
+	{
+		m_sampleBudget = maxInstances;
+	}
+
+	//advances all instances by dt seconds and samples them (within the budget)
+	void update(float dt);
+
+	//getJointCount() poses of the instance as of its last sample
+	const JointPose* getPose(InstanceId instance) const
+	{
+		return &m_poses[instance * m_jointCount];
+	}
+	uint32_t getJointCount() const
+	{
+		return m_jointCount;
+	}
+	size_t getInstanceCount() const
+	{
+		return m_clip.size();
+	}
+	//instances sampled by the last update
+	size_t getSampledCount() const
+	{
+		return m_sampled;
+	}
+
+	//out = from blended towards to by weight (0: from, 1: to); position/scale lerp, rotation slerp
+	static void blend(const JointPose* from, const JointPose* to, float weight, JointPose* out, size_t count);
+
+private:
+	uint32_t m_jointCount;
+
+	//per instance
+	std::vector<const AnimationClip*> m_clip;
+	std::vector<float> m_time;
+	std::vector<const AnimationClip*> m_fadeClip;	//previous clip while fading, nullptr otherwise
+	std::vector<float> m_fadeTime;
+	std::vector<float> m_fadeElapsed;
+	std::vector<float> m_fadeDuration;
+	std::vector<float> m_speed;
+	std::vector<uint32_t> m_cursor;					//two clip cursors per instance
+	std::vector<JointPose> m_poses;					//m_jointCount per instance
+
+	std::vector<JointPose> m_scratch;
+	size_t m_sampleBudget;
+	size_t m_nextSample;
+	size_t m_sampled;
+
+	void checkInstance(InstanceId instance) const;
+	uint32_t* cursor(InstanceId instance, int slot)
+	{
+		return &m_cursor[(instance * 2 + slot) * m_jointCount * 3];
+	}
+	static float advance(const AnimationClip* clip, float time, float dt);
+	void sampleInstance(InstanceId instance);
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include "Skeleton.h"
+
+const uint32_t Skeleton::NO_PARENT;
+
+uint32_t Skeleton::addJoint(uint32_t parent, const glm::mat4 & offset)
+{
+	uint32_t joint = static_cast<uint32_t>(m_parent.size());
+	if (parent != NO_PARENT && parent >= joint)
+		throw std::logic_error("Skeleton joints have to be added after their parent.");
+	m_parent.push_back(parent);
+	m_offset.push_back(offset);
+	m_bind.push_back(glm::mat4(1.0f));
+	m_inverseBind.push_back(glm::mat4(1.0f));
+	return joint;
+}
+
+void Skeleton::setBindPose(const JointPose * pose)
+{
+	computeWorld(pose, m_bind.data());
+	for (size_t j = 0; j < m_bind.size(); j++)
+		m_inverseBind[j] = glm::inverse(m_bind[j]);
+}
+
+void Skeleton::computeWorld(const JointPose * pose, glm::mat4 * world) const
+{
+	for (size_t j = 0; j < m_parent.size(); j++)
+	{
+		glm::mat4 local = m_offset[j] * pose[j].toMatrix();
+		world[j] = m_parent[j] == NO_PARENT ? local : world[m_parent[j]] * local;
+	}
+}
+
+void Skeleton::computePalette(const JointPose * pose, glm::mat4 * palette, const glm::mat4 & model) const
+{
+	//posed model space first (parents are done before their children), then the bind pose is taken out
+	for (size_t j = 0; j < m_parent.size(); j++)
+	{
+		glm::mat4 local = m_offset[j] * pose[j].toMatrix();
+		palette[j] = (m_parent[j] == NO_PARENT ? model : palette[m_parent[j]]) * local;
+	}
+	for (size_t j = 0; j < m_parent.size(); j++)
+		palette[j] = palette[j] * m_inverseBind[j];
+}
@@ -0,0 +1,44 @@
+#ifndef _SKELETON_H_
+#define _SKELETON_H_
+#include "AnimationClip.h"
+#include <vector>
+#include <cstdint>
+
+//Joint hierarchy of a skinned mesh. Joint indices match the joints of the AnimationClips that drive it.
+//computePalette turns a pose into the matrices the vertices are skinned with: bind pose model space -> posed model space.
+class Skeleton
+{
+public:
+	static const uint32_t NO_PARENT = 0xFFFFFFFFu;
+
+	Skeleton() {}
+
+	//Parents have to be added before their children.
+	//offset: fixed transform from the parent joint to the space this joint's pose applies in (identity for plain bones)
+	uint32_t addJoint(uint32_t parent, const glm::mat4& offset = glm::mat4(1.0f));
+	//the pose the mesh was modelled in, sets the inverse bind matrices
+	void setBindPose(const JointPose* pose);
+
+	//joint to model space: world[j] = world[parent] * offset[j] * pose[j]
+	void computeWorld(const JointPose* pose, glm::mat4* world) const;
+	//palette[j] = model * world[j] * inverseBind[j]
+	void computePalette(const JointPose* pose, glm::mat4* palette, const glm::mat4& model = glm::mat4(1.0f)) const;
+
+	//joint to model space in the bind pose, for building meshes around the joints
+	const glm::mat4& getBindMatrix(uint32_t joint) const
+	{
+		return m_bind[joint];
+	}
+	uint32_t getJointCount() const
+	{
+		return static_cast<uint32_t>(m_parent.size());
+	}
+
+private:
+	std::vector<uint32_t> m_parent;
+	std::vector<glm::mat4> m_offset;
+	std::vector<glm::mat4> m_bind;
+	std::vector<glm::mat4> m_inverseBind;
+};
+
+#endif
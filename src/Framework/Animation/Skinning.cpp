@@ -0,0 +1,110 @@
+#include "Skinning.h"
+#include <fw_config.h>
+#include <algorithm>
+#include <cmath>
+
+#ifdef VC_SSE2
+#include <emmintrin.h>
+#endif
+
+Skinning::Skinning()
+{
+}
+
+Skinning::~Skinning()
+{
+}
+
+VertexSkin Skinning::packInfluences(const glm::uvec4 & joints, const glm::vec4 & weights)
+{
+	VertexSkin skin;
+	float sum = 0.0f;
+	for (int k = 0; k < 4; k++)
+	{
+		skin.joints[k] = static_cast<GLubyte>(std::min(joints[k], 255u));
+		sum += std::max(weights[k], 0.0f);
+	}
+	if (sum <= 0.0f)
+	{
+		//no influence given: rigid on the first joint
+		skin.weights[0] = 255;
+		skin.weights[1] = skin.weights[2] = skin.weights[3] = 0;
+		return skin;
+	}
+	//round down, then hand the rest out by the largest remainders
+	float remainder[4];
+	int total = 0;
+	for (int k = 0; k < 4; k++)
+	{
+		float scaled = std::max(weights[k], 0.0f) / sum * 255.0f;
+		skin.weights[k] = static_cast<GLubyte>(std::floor(scaled));
+		remainder[k] = scaled - skin.weights[k];
+		total += skin.weights[k];
+	}
+	for (; total < 255; total++)
+	{
+		int largest = static_cast<int>(std::max_element(remainder, remainder + 4) - remainder);
+		skin.weights[largest]++;
+		remainder[largest] = -1.0f;
+	}
+	return skin;
+}
+
+void Skinning::skinVertices(const glm::mat4 * palette, const Vertex * in, const VertexSkin * skin, size_t count, Vertex * out)
+{
+	const float toweight = 1.0f / 255.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex v = in[i];
+		const VertexSkin& s = skin[i];
+#ifdef VC_SSE2
+		//weighted sum of the palette columns, influences without weight are skipped (rigid vertices have one)
+		const float* m = &palette[s.joints[0]][0][0];
+		__m128 w = _mm_set1_ps(s.weights[0] * toweight);
+		__m128 c0 = _mm_mul_ps(_mm_loadu_ps(m), w);
+		__m128 c1 = _mm_mul_ps(_mm_loadu_ps(m + 4), w);
+		__m128 c2 = _mm_mul_ps(_mm_loadu_ps(m + 8), w);
+		__m128 c3 = _mm_mul_ps(_mm_loadu_ps(m + 12), w);
+		for (int k = 1; k < 4; k++)
+		{
+			if (!s.weights[k])
+				continue;
+			m = &palette[s.joints[k]][0][0];
+			w = _mm_set1_ps(s.weights[k] * toweight);
+			c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(m), w));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(m + 4), w));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(m + 8), w));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(m + 12), w));
+		}
+		__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.position.x)), _mm_mul_ps(c1, _mm_set1_ps(v.position.y))),
+			_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(v.position.z)), c3));
+		__m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.normal.x)), _mm_mul_ps(c1, _mm_set1_ps(v.normal.y))),
+			_mm_mul_ps(c2, _mm_set1_ps(v.normal.z)));
+		__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.tangent.x)), _mm_mul_ps(c1, _mm_set1_ps(v.tangent.y))),
+			_mm_mul_ps(c2, _mm_set1_ps(v.tangent.z)));
+		float pf[4], nf[4], tf[4];
+		_mm_storeu_ps(pf, p);
+		_mm_storeu_ps(nf, n);
+		_mm_storeu_ps(tf, t);
+		glm::vec3 position(pf[0], pf[1], pf[2]);
+		glm::vec3 normal(nf[0], nf[1], nf[2]);
+		glm::vec3 tangent(tf[0], tf[1], tf[2]);
+#else
+		glm::mat4 m = palette[s.joints[0]] * (s.weights[0] * toweight);
+		for (int k = 1; k < 4; k++)
+		{
+			if (s.weights[k])
+				m += palette[s.joints[k]] * (s.weights[k] * toweight);
+		}
+		glm::vec3 position(m * glm::vec4(v.position, 1.0f));
+		glm::vec3 normal(m * glm::vec4(v.normal, 0.0f));
+		glm::vec3 tangent(m * glm::vec4(v.tangent, 0.0f));
+#endif
+		out[i].position = position;
+		out[i].uv = v.uv;
+		float nl = glm::length(normal);
+		out[i].normal = nl > 0.0f ? normal / nl : normal;
+		float tl = glm::length(tangent);
+		out[i].tangent = tl > 0.0f ? tangent / tl : tangent;
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef _SKINNING_H_
+#define _SKINNING_H_
+#include <libheaders.h>
+#include <CommonTypes.h>
+#include <cstddef>
+
+//Linear blend skinning on the CPU, for tools, tests and headless use.
+//The renderer skins in the vertex shader instead (shader variant SKINNING, SkinnedMeshBatch); both use the same
+//palette (Skeleton::computePalette) and the same VertexSkin stream.
+class Skinning
+{
+private:
+	Skinning();
+	~Skinning();
+
+public:
+	//up to four influences; weights are normalized and rounded so the stored bytes sum up to 255
+	static VertexSkin packInfluences(const glm::uvec4& joints, const glm::vec4& weights);
+
+	//out[i] = in[i] with position, normal and tangent transformed by the weighted sum of its palette matrices.
+	//Normals and tangents are renormalized. Uses SSE when available. in and out may be the same array.
+	static void skinVertices(const glm::mat4* palette, const Vertex* in, const VertexSkin* skin, size_t count, Vertex* out);
+};
+
+#endif
@@ -1,12 +1,95 @@
 #include "AssetManager.h"
+#include <ShaderBinaryCache.h>
+#include <algorithm>
+#include <set>
+#include <vector>
 
+namespace
+{
+	std::string directoryOf(const std::string& path)
+	{
+		size_t pos = path.find_last_of("/\\");
+		return pos == std::string::npos ? std::string() : path.substr(0, pos + 1);
+	}
+
+	//collapses "." and "dir/.." so that every file has one name
+	std::string normalizePath(const std::string& path)
+	{
+		std::vector<std::string> parts;
+		size_t pos = 0;
+		while (pos <= path.size())
+		{
+			size_t end = path.find_first_of("/\\", pos);
+			end = end == std::string::npos ? path.size() : end;
+			std::string part = path.substr(pos, end - pos);
+			if (part == ".." && !parts.empty() && parts.back() != ".." && !parts.back().empty())
+				parts.pop_back();
+			else if (part != "." && (!part.empty() || parts.empty()))
+				parts.push_back(part);
+			pos = end + 1;
+		}
+		std::string result;
+		for (size_t i = 0; i < parts.size(); i++)
+		{
+			if (i > 0)
+				result.push_back('/');
+			result.append(parts[i]);
+		}
+		return result;
+	}
 
+	void resolve(const std::string& code, const std::string& path, std::set<std::string>& included, int& sourcecount, std::string& out)
+	{
+		int source = sourcecount++;
+		std::string directory = directoryOf(path);
+		size_t line = 1;
+		size_t pos = 0;
+		while (pos < code.size())
+		{
+			size_t end = code.find('\n', pos);
+			end = end == std::string::npos ? code.size() : end + 1;
+			size_t first = code.find_first_not_of(" \t", pos);
+			if (first < end && code.compare(first, 8, "#include") == 0)
+			{
+				size_t open = code.find('"', first + 8);
+				size_t close = open < end ? code.find('"', open + 1) : std::string::npos;
+				if (close >= end)
+					throw std::logic_error("Malformed #include in " + path + " line " + std::to_string(line) + ".");
+				std::string includepath = normalizePath(directory + code.substr(open + 1, close - open - 1));
+				//every file once: shared blocks can be included from several places, cycles end here
+				if (included.insert(includepath).second)
+				{
+					std::ifstream file(includepath);
+					if (!file.is_open())
+						throw std::logic_error("Shader include file not found: " + includepath);
+					std::stringstream stream;
+					stream << file.rdbuf();
+					out.append("#line 1 " + std::to_string(sourcecount) + "\n");
+					resolve(stream.str(), includepath, included, sourcecount, out);
+					out.append("\n#line " + std::to_string(line + 1) + " " + std::to_string(source) + "\n");
+				}
+				else
+				{
+					out.append("\n");
+				}
+			}
+			else
+			{
+				out.append(code, pos, end - pos);
+			}
+			pos = end;
+			line++;
+		}
+	}
+}
 
-std::unique_ptr<ShaderProgram> AssetManager::createShaderProgram(const std::string & vspath, const std::string & fspath)
+std::unique_ptr<ShaderProgram> AssetManager::createShaderProgram(const std::string & vspath, const std::string & fspath, const std::string & defines)
+{
+	return createShaderProgramAsync(vspath, fspath, defines)->get();
+}
+
+std::unique_ptr<PendingShaderProgram> AssetManager::createShaderProgramAsync(const std::string & vspath, const std::string & fspath, const std::string & defines)
 {
-	GLuint vertexShader;
-	GLuint fragmentShader;
-	GLuint program;
 	std::string vertexCode;
 	std::string fragmentCode;
 	std::ifstream vShaderFile;
@@ -26,8 +109,8 @@ std::unique_ptr<ShaderProgram> AssetManager::createShaderProgram(const std::stri
 		fShaderStream << fShaderFile.rdbuf();
 		vShaderFile.close();
 		fShaderFile.close();
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+		vertexCode = injectDefines(resolveIncludes(vShaderStream.str(), vspath), defines);
+		fragmentCode = injectDefines(resolveIncludes(fShaderStream.str(), fspath), defines);
 	}
 	catch (const std::exception& ex)
 	{
@@ -36,65 +119,51 @@ std::unique_ptr<ShaderProgram> AssetManager::createShaderProgram(const std::stri
 		errmsg.append(ex.what());
 		throw std::logic_error(errmsg.c_str());
 	}
-	const GLchar* vShaderCode = vertexCode.c_str();
-	const GLchar* fShaderCode = fragmentCode.c_str();
-	GLint success;
-	GLchar infoLog[512];
-	vertexShader = glCreateShader(GL_VERTEX_SHADER); GLERR
-	glShaderSource(vertexShader, 1, &vShaderCode, NULL); GLERR
-	glCompileShader(vertexShader); GLERR
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success); GLERR
-	if (!success)
-	{
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog); GLERR
-		std::string errmsg;
-		errmsg.append("Compiler error in vertex shader:\n");
-		errmsg.append(infoLog);
-		glDeleteShader(vertexShader); GLERR
-		throw std::logic_error(errmsg.c_str());
-	}
-	else {
-		std::cout << "Vertex shader compiled successfully!"<< std::endl;
-	}
-	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER); GLERR
-	glShaderSource(fragmentShader, 1, &fShaderCode, NULL); GLERR
-	glCompileShader(fragmentShader); GLERR
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success); GLERR
-	if (!success)
-	{
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog); GLERR
-		std::string errmsg;
-		errmsg.append("Compiler error in fragment shader:\n");
-		errmsg.append(infoLog);
-		glDeleteShader(vertexShader); GLERR
-		glDeleteShader(fragmentShader); GLERR
-		throw std::logic_error(errmsg.c_str());
-	}
-	else {
-		std::cout << "Fragment shader compiled successfully!" << std::endl;
-	}
-	program = glCreateProgram(); GLERR
-	glAttachShader(program, vertexShader); GLERR
-	glAttachShader(program, fragmentShader); GLERR
-	glLinkProgram(program); GLERR
-	glGetProgramiv(program, GL_LINK_STATUS, &success); GLERR
-	if (!success)
+	uint64_t cacheKey = ShaderBinaryCache::makeKey(vertexCode, fragmentCode, defines);
+	GLuint program = ShaderBinaryCache::load(cacheKey);
+	if (program)
+		return std::unique_ptr<PendingShaderProgram>(new PendingShaderProgram(program));
+	return std::unique_ptr<PendingShaderProgram>(new PendingShaderProgram(vertexCode, fragmentCode, cacheKey));
+}
+
+std::string AssetManager::resolveIncludes(const std::string & code, const std::string & path)
+{
+	if (code.find("#include") == std::string::npos)
+		return code;
+	std::set<std::string> included;
+	included.insert(normalizePath(path));
+	int sourcecount = 0;
+	std::string result;
+	result.reserve(code.size());
+	resolve(code, path, included, sourcecount, result);
+	return result;
+}
+
+std::string AssetManager::injectDefines(const std::string & code, const std::string & defines)
+{
+	if (defines.empty())
+		return code;
+	//#version has to stay the first statement, the defines go into the line after it
+	size_t pos = 0;
+	size_t version = code.find("#version");
+	if (version != std::string::npos)
 	{
-		glGetProgramInfoLog(program, 512, NULL, infoLog); GLERR
-		std::string errmsg;
-		errmsg.append("Linker error in program:\n");
-		errmsg.append(infoLog);
-		glDetachShader(program, vertexShader); GLERR
-		glDetachShader(program, fragmentShader); GLERR
-		glDeleteShader(vertexShader); GLERR
-		glDeleteShader(fragmentShader); GLERR
-		throw std::logic_error(errmsg.c_str());
+		pos = code.find('\n', version);
+		pos = pos == std::string::npos ? code.size() : pos + 1;
 	}
-	glDetachShader(program, vertexShader); GLERR
-	glDetachShader(program, fragmentShader); GLERR
-	glDeleteShader(vertexShader); GLERR
-	glDeleteShader(fragmentShader); GLERR
-	return std::unique_ptr<ShaderProgram>(new ShaderProgram(program));
+	size_t line = 1 + static_cast<size_t>(std::count(code.begin(), code.begin() + pos, '\n'));
+	std::string result;
+	result.reserve(code.size() + defines.size() + 16);
+	result.append(code, 0, pos);
+	if (version != std::string::npos && (pos == 0 || code[pos - 1] != '\n'))
+		result.push_back('\n');
+	result.append(defines);
+	if (defines.back() != '\n')
+		result.push_back('\n');
+	//keep the line numbers of compiler messages pointing into the file
+	result.append("#line " + std::to_string(line) + "\n");
+	result.append(code, pos, std::string::npos);
+	return result;
 }
 
 
@@ -103,18 +172,149 @@ ShaderProgram * AssetManager::getShaderProgram(const std::string & name)
 	auto it = m_shaders.find(name);
 	if (it != m_shaders.end())
 		return it->second.get();
+	//requested but not started yet
+	for (auto request = m_requests.begin(); request != m_requests.end(); ++request)
+	{
+		if (request->variant == name)
+		{
+			VariantRequest started = *request;
+			m_requests.erase(request);
+			startRequest(started);
+			break;
+		}
+	}
+	//still compiling: needed now, so wait for it
+	auto pending = m_pending.find(name);
+	if (pending != m_pending.end())
+	{
+		std::unique_ptr<PendingShaderProgram> program = std::move(pending->second);
+		m_pending.erase(pending);
+		addShaderProgram(name, program->get());
+		return m_shaders[name].get();
+	}
 	return nullptr;
 }
 
+ShaderProgram * AssetManager::findShaderProgram(const std::string & name)
+{
+	auto it = m_shaders.find(name);
+	return it != m_shaders.end() ? it->second.get() : nullptr;
+}
+
 
 void AssetManager::addShaderProgram(const std::string & name, std::unique_ptr<ShaderProgram>&& shader)
 {
+	if (shader)
+	{
+		for (const auto& block : shader->getUniformBlocks())
+			shader->setUniformBlockBinding(block.first, getUniformBlockBinding(block.first));
+	}
 	m_shaders.insert(std::make_pair(name, std::move(shader)));
 }
 
 
+void AssetManager::addShaderProgram(const std::string & name, std::unique_ptr<PendingShaderProgram>&& shader)
+{
+	if (shader)
+		m_pending[name] = std::move(shader);
+}
+
+size_t AssetManager::updatePendingShaderPrograms(size_t maxstarts)
+{
+	for (size_t i = 0; i < maxstarts && !m_requests.empty(); i++)
+	{
+		VariantRequest request = m_requests.front();
+		m_requests.pop_front();
+		startRequest(request);
+	}
+	for (auto it = m_pending.begin(); it != m_pending.end();)
+	{
+		if (it->second->isReady())
+		{
+			std::unique_ptr<PendingShaderProgram> program = std::move(it->second);
+			std::string name = it->first;
+			it = m_pending.erase(it);
+			addShaderProgram(name, program->get());
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return m_pending.size() + m_requests.size();
+}
+
+void AssetManager::registerShader(const std::string & name, const std::string & vspath, const std::string & fspath)
+{
+	ShaderSource source;
+	source.vspath = vspath;
+	source.fspath = fspath;
+	m_sources[name] = source;
+}
+
+std::string AssetManager::getVariantName(const std::string & name, const ShaderDefines & defines)
+{
+	if (defines.empty())
+		return name;
+	return name + "#" + defines.toKey();
+}
+
+std::string AssetManager::requestShaderVariant(const std::string & name, const ShaderDefines & defines)
+{
+	std::string variant = getVariantName(name, defines);
+	if (m_shaders.count(variant) || m_pending.count(variant))
+		return variant;
+	for (const auto& request : m_requests)
+	{
+		if (request.variant == variant)
+			return variant;
+	}
+	if (!m_sources.count(name))
+		throw std::logic_error("Shader \"" + name + "\" is not registered.");
+	VariantRequest request;
+	request.variant = variant;
+	request.shader = name;
+	request.defines = defines;
+	m_requests.push_back(request);
+	return variant;
+}
+
+ShaderProgram * AssetManager::getShaderVariant(const std::string & name, const ShaderDefines & defines)
+{
+	std::string variant = getVariantName(name, defines);
+	auto it = m_shaders.find(variant);
+	if (it != m_shaders.end())
+		return it->second.get();
+	return getShaderProgram(requestShaderVariant(name, defines));
+}
+
+void AssetManager::startRequest(const VariantRequest & request)
+{
+	const ShaderSource& source = m_sources.at(request.shader);
+	addShaderProgram(request.variant, createShaderProgramAsync(source.vspath, source.fspath, request.defines.toSource()));
+}
+
 bool AssetManager::removeShaderProgram(const std::string & name)
 {
-	return m_shaders.erase(name);
+	size_t removed = m_shaders.erase(name) + m_pending.erase(name);
+	for (auto request = m_requests.begin(); request != m_requests.end(); ++request)
+	{
+		if (request->variant == name)
+		{
+			m_requests.erase(request);
+			removed++;
+			break;
+		}
+	}
+	return removed > 0;
 }
 
+GLuint AssetManager::getUniformBlockBinding(const std::string & blockname)
+{
+	auto it = m_blockBindings.find(blockname);
+	if (it != m_blockBindings.end())
+		return it->second;
+	GLuint binding = static_cast<GLuint>(m_blockBindings.size());
+	m_blockBindings.insert(std::make_pair(blockname, binding));
+	return binding;
+}
@@ -1,24 +1,78 @@
 #pragma once
 #include <ShaderProgram.h>
+#include <PendingShaderProgram.h>
+#include <ShaderDefines.h>
+#include <deque>
 #include <memory>
 #include <libheaders.h>
 #include <unordered_map>
-#include <memory>
 
 class AssetManager
 {
 private:
 	std::unordered_map<std::string, std::unique_ptr<ShaderProgram>> m_shaders;
+	std::unordered_map<std::string, GLuint> m_blockBindings;
+	std::unordered_map<std::string, std::unique_ptr<PendingShaderProgram>> m_pending;
+
+	class ShaderSource
+	{
+	public:
+		std::string vspath;
+		std::string fspath;
+	};
+	class VariantRequest
+	{
+	public:
+		std::string variant;
+		std::string shader;
+		ShaderDefines defines;
+	};
+	std::unordered_map<std::string, ShaderSource> m_sources;
+	std::deque<VariantRequest> m_requests;	//requested variants that haven't been started
+
+	void startRequest(const VariantRequest& request);
 
 public:
 
 	//factory functions
-	static std::unique_ptr<ShaderProgram> createShaderProgram(const std::string& vspath, const std::string& fspath);
+	//defines: preprocessor lines ("#define SKINNING\n...") inserted after the #version line of both shaders.
+	//Linked programs are kept in the ShaderBinaryCache and loaded from there on later starts.
+	static std::unique_ptr<ShaderProgram> createShaderProgram(const std::string& vspath, const std::string& fspath, const std::string& defines = "");
+	//Same, but only starts compiling and linking. Start all programs first and check them later,
+	//so the driver can compile them in parallel with each other and with other loading.
+	static std::unique_ptr<PendingShaderProgram> createShaderProgramAsync(const std::string& vspath, const std::string& fspath, const std::string& defines = "");
+	static std::string injectDefines(const std::string& code, const std::string& defines);
+	//Replaces every '#include "file"' line with the file, relative to the including file. Each file is included
+	//once, later includes of it are dropped. #line directives keep compiler messages pointing at the right file
+	//(source string number = order of first inclusion, 0 for the main file) and line.
+	static std::string resolveIncludes(const std::string& code, const std::string& path);
+	//name of a variant in the shader map: name, or name#DEFINE=VALUE;... if defines isn't empty
+	static std::string getVariantName(const std::string& name, const ShaderDefines& defines);
 
 	//member functions
+	//waits for the program if it was added as pending and isn't finished yet
 	ShaderProgram* getShaderProgram(const std::string& name);
+	//never waits: nullptr while the program is queued or compiling (see updatePendingShaderPrograms)
+	ShaderProgram* findShaderProgram(const std::string& name);
+	//also binds the uniform blocks of shader to the binding points of getUniformBlockBinding
 	void addShaderProgram(const std::string& name, std::unique_ptr<ShaderProgram>&& shader);
+	//adds the program under name as soon as it is finished (updatePendingShaderPrograms or getShaderProgram)
+	void addShaderProgram(const std::string& name, std::unique_ptr<PendingShaderProgram>&& shader);
+	//Starts up to maxstarts requested variants, then adds all finished pending programs without blocking.
+	//Call once per frame. Returns the number of programs still queued or compiling.
+	size_t updatePendingShaderPrograms(size_t maxstarts = 2);
+
+	//Registers a vertex/fragment pair under name. Nothing is compiled until a variant of it is requested.
+	void registerShader(const std::string& name, const std::string& vspath, const std::string& fspath);
+	//Queues a variant of a registered shader, it is compiled in the background by updatePendingShaderPrograms.
+	//Returns the variant name, usable with getShaderProgram.
+	std::string requestShaderVariant(const std::string& name, const ShaderDefines& defines);
+	//the variant, compiled right now if it isn't finished yet
+	ShaderProgram* getShaderVariant(const std::string& name, const ShaderDefines& defines);
 	bool removeShaderProgram(const std::string& name);
+	//Binding point of a uniform block name. Blocks with the same name share it across all added programs,
+	//so a buffer range bound there is seen by every program.
+	GLuint getUniformBlockBinding(const std::string& blockname);
 
 };
 
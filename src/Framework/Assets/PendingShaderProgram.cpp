@@ -0,0 +1,150 @@
+#include "PendingShaderProgram.h"
+#include <ShaderBinaryCache.h>
+#include <iostream>
+
+namespace
+{
+	bool parallelChecked = false;
+	bool parallelCompile = false;
+}
+
+bool PendingShaderProgram::enableParallelCompile()
+{
+	if (parallelChecked)
+		return parallelCompile;
+	parallelChecked = true;
+	if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); GLERR
+		parallelCompile = true;
+	}
+	else if (GLEW_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF); GLERR
+		parallelCompile = true;
+	}
+	return parallelCompile;
+}
+
+PendingShaderProgram::PendingShaderProgram(const std::string & vscode, const std::string & fscode, uint64_t cachekey) :
+	m_vertexShader(0),
+	m_fragmentShader(0),
+	m_program(0),
+	m_cacheKey(cachekey),
+	m_linked(false)
+{
+	enableParallelCompile();
+	const GLchar* vShaderCode = vscode.c_str();
+	const GLchar* fShaderCode = fscode.c_str();
+	m_vertexShader = glCreateShader(GL_VERTEX_SHADER); GLERR
+	glShaderSource(m_vertexShader, 1, &vShaderCode, NULL); GLERR
+	glCompileShader(m_vertexShader); GLERR
+	m_fragmentShader = glCreateShader(GL_FRAGMENT_SHADER); GLERR
+	glShaderSource(m_fragmentShader, 1, &fShaderCode, NULL); GLERR
+	glCompileShader(m_fragmentShader); GLERR
+	//link right away: a failed compile just fails the link, get() reports the compile error first
+	m_program = glCreateProgram(); GLERR
+	glAttachShader(m_program, m_vertexShader); GLERR
+	glAttachShader(m_program, m_fragmentShader); GLERR
+	ShaderBinaryCache::prepareLink(m_program);
+	glLinkProgram(m_program); GLERR
+}
+
+PendingShaderProgram::PendingShaderProgram(GLuint program) :
+	m_vertexShader(0),
+	m_fragmentShader(0),
+	m_program(program),
+	m_cacheKey(0),
+	m_linked(true)
+{}
+
+PendingShaderProgram::~PendingShaderProgram()
+{
+	release();
+	GLStateCache::deleteProgram(m_program);
+}
+
+void PendingShaderProgram::release()
+{
+	if (m_vertexShader)
+	{
+		if (m_program)
+		{
+			glDetachShader(m_program, m_vertexShader); GLERR
+		}
+		glDeleteShader(m_vertexShader); GLERR
+		m_vertexShader = 0;
+	}
+	if (m_fragmentShader)
+	{
+		if (m_program)
+		{
+			glDetachShader(m_program, m_fragmentShader); GLERR
+		}
+		glDeleteShader(m_fragmentShader); GLERR
+		m_fragmentShader = 0;
+	}
+}
+
+bool PendingShaderProgram::isReady() const
+{
+	if (m_linked || !m_program || !parallelCompile)
+		return true;
+	GLint done = GL_FALSE;
+	glGetProgramiv(m_program, GL_COMPLETION_STATUS_ARB, &done); GLERR
+	return done == GL_TRUE;
+}
+
+std::unique_ptr<ShaderProgram> PendingShaderProgram::get()
+{
+	if (!m_program)
+		throw std::logic_error("Shader program has already been taken.");
+	if (m_linked)
+	{
+		std::cout << "Shader program loaded from the binary cache!" << std::endl;
+		GLuint program = m_program;
+		m_program = 0;
+		return std::unique_ptr<ShaderProgram>(new ShaderProgram(program));
+	}
+
+	GLint success;
+	GLchar infoLog[512];
+	glGetShaderiv(m_vertexShader, GL_COMPILE_STATUS, &success); GLERR
+	if (!success)
+	{
+		glGetShaderInfoLog(m_vertexShader, 512, NULL, infoLog); GLERR
+		std::string errmsg;
+		errmsg.append("Compiler error in vertex shader:\n");
+		errmsg.append(infoLog);
+		throw std::logic_error(errmsg.c_str());
+	}
+	else {
+		std::cout << "Vertex shader compiled successfully!" << std::endl;
+	}
+	glGetShaderiv(m_fragmentShader, GL_COMPILE_STATUS, &success); GLERR
+	if (!success)
+	{
+		glGetShaderInfoLog(m_fragmentShader, 512, NULL, infoLog); GLERR
+		std::string errmsg;
+		errmsg.append("Compiler error in fragment shader:\n");
+		errmsg.append(infoLog);
+		throw std::logic_error(errmsg.c_str());
+	}
+	else {
+		std::cout << "Fragment shader compiled successfully!" << std::endl;
+	}
+	glGetProgramiv(m_program, GL_LINK_STATUS, &success); GLERR
+	if (!success)
+	{
+		glGetProgramInfoLog(m_program, 512, NULL, infoLog); GLERR
+		std::string errmsg;
+		errmsg.append("Linker error in program:\n");
+		errmsg.append(infoLog);
+		throw std::logic_error(errmsg.c_str());
+	}
+	release();
+	ShaderBinaryCache::store(m_cacheKey, m_program);
+	GLuint program = m_program;
+	m_program = 0;
+	return std::unique_ptr<ShaderProgram>(new ShaderProgram(program));
+}
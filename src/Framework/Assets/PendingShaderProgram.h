@@ -0,0 +1,45 @@
+#ifndef _PENDING_SHADER_PROGRAM_H_
+#define _PENDING_SHADER_PROGRAM_H_
+#include <libheaders.h>
+#include <glerror.h>
+#include <ShaderProgram.h>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+//Shader program whose compile and link have been started but not checked yet.
+//The constructor only issues glCompileShader/glLinkProgram; nothing queries a status until get(), so drivers
+//that compile in the background keep doing so while the caller does other work.
+//With GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile isReady() polls GL_COMPLETION_STATUS,
+//without it isReady() is always true and get() waits for the driver.
+class PendingShaderProgram
+{
+public:
+	//starts compiling and linking. cachekey: ShaderBinaryCache entry the binary is stored under after the link
+	PendingShaderProgram(const std::string& vscode, const std::string& fscode, uint64_t cachekey);
+	//already linked program (i.e. from the binary cache)
+	explicit PendingShaderProgram(GLuint program);
+	~PendingShaderProgram();
+	PendingShaderProgram(const PendingShaderProgram& other) = delete;
+	PendingShaderProgram& operator=(const PendingShaderProgram& other) = delete;
+
+	//true if get() will not block. Never blocks itself.
+	bool isReady() const;
+	//Waits for the link and checks it. Throws std::logic_error with the compiler or linker log on failure.
+	//Can be called once, the program belongs to the caller afterwards.
+	std::unique_ptr<ShaderProgram> get();
+
+	//lets the driver use as many compiler threads as it likes. Called by the constructor once per run.
+	static bool enableParallelCompile();
+
+private:
+	GLuint m_vertexShader;
+	GLuint m_fragmentShader;
+	GLuint m_program;
+	uint64_t m_cacheKey;
+	bool m_linked;		//came linked, nothing to check
+
+	void release();
+};
+
+#endif
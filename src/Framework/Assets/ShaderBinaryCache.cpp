@@ -0,0 +1,170 @@
+#include "ShaderBinaryCache.h"
+#include <ContentHash.h>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	const char MAGIC[8] = { 'V', 'C', 'S', 'H', 'A', 'D', 'E', 'R' };
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t format;
+		uint64_t key;
+		uint64_t size;
+	};
+
+	std::string directory = "assets/shaders/cache";
+
+	std::string getString(GLenum name)
+	{
+		const GLubyte* str = glGetString(name); GLERR
+		return str ? std::string(reinterpret_cast<const char*>(str)) : std::string();
+	}
+
+	void makeDirectory(const std::string& path)
+	{
+		//fails if it exists already, that's fine
+#ifdef _WIN32
+		_mkdir(path.c_str());
+#else
+		mkdir(path.c_str(), 0755);
+#endif
+	}
+}
+
+void ShaderBinaryCache::setDirectory(const std::string & dir)
+{
+	directory = dir;
+}
+
+const std::string & ShaderBinaryCache::getDirectory()
+{
+	return directory;
+}
+
+bool ShaderBinaryCache::isSupported()
+{
+	if (directory.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats); GLERR
+	return formats > 0;
+}
+
+uint64_t ShaderBinaryCache::makeKey(const std::string & vscode, const std::string & fscode, const std::string & defines)
+{
+	//'\0' separated, so moving text from one part to the next changes the key
+	std::string data;
+	data.reserve(vscode.size() + fscode.size() + defines.size() + 256);
+	data.append(getString(GL_VENDOR)).push_back('\0');
+	data.append(getString(GL_RENDERER)).push_back('\0');
+	data.append(getString(GL_VERSION)).push_back('\0');
+	data.append(defines).push_back('\0');
+	data.append(vscode).push_back('\0');
+	data.append(fscode);
+	return ContentHash::hash(data.data(), data.size());
+}
+
+std::string ShaderBinaryCache::getPath(uint64_t key)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.glbin", static_cast<unsigned long long>(key));
+	return directory + "/" + name;
+}
+
+void ShaderBinaryCache::prepareLink(GLuint program)
+{
+	if (isSupported())
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); GLERR
+	}
+}
+
+GLuint ShaderBinaryCache::load(uint64_t key)
+{
+	if (!isSupported())
+		return 0;
+	std::ifstream stream(getPath(key), std::ios_base::in | std::ios_base::binary);
+	if (!stream.is_open())
+		return 0;
+	Header header;
+	if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+		header.version != VERSION || header.key != key || header.size == 0 || header.size > (1u << 30))
+		return 0;
+	std::vector<char> binary(static_cast<size_t>(header.size));
+	if (!stream.read(binary.data(), binary.size()))
+		return 0;
+
+	GLuint program = glCreateProgram(); GLERR
+	glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+	//A format the driver no longer knows raises GL_INVALID_ENUM, a rejected binary (i.e. after a driver change
+	//with the same version string) only fails GL_LINK_STATUS. Both are misses, not errors.
+	GLenum error = glGetError();
+	GLint success = GL_FALSE;
+	if (error == GL_NO_ERROR)
+	{
+		glGetProgramiv(program, GL_LINK_STATUS, &success); GLERR
+	}
+	if (!success)
+	{
+		glDeleteProgram(program); GLERR
+		return 0;
+	}
+	return program;
+}
+
+void ShaderBinaryCache::store(uint64_t key, GLuint program)
+{
+	if (!isSupported())
+		return;
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length); GLERR
+	if (length <= 0)
+		return;
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &format, binary.data()); GLERR
+	if (written <= 0)
+		return;
+
+	Header header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.format = format;
+	header.key = key;
+	header.size = static_cast<uint64_t>(written);
+
+	makeDirectory(directory);
+	//write to a temporary file first, so an interrupted write never leaves a valid looking entry behind
+	std::string path = getPath(key);
+	std::string tmppath = path + ".tmp";
+	{
+		std::ofstream stream(tmppath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		if (!stream.is_open())
+			return;
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(binary.data(), written);
+		if (!stream)
+		{
+			stream.close();
+			std::remove(tmppath.c_str());
+			return;
+		}
+	}
+	std::remove(path.c_str());
+	if (std::rename(tmppath.c_str(), path.c_str()) != 0)
+		std::remove(tmppath.c_str());
+}
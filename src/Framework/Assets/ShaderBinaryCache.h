@@ -0,0 +1,42 @@
+#ifndef _SHADER_BINARY_CACHE_H_
+#define _SHADER_BINARY_CACHE_H_
+#include <libheaders.h>
+#include <glerror.h>
+#include <string>
+#include <cstdint>
+
+//Cache of linked program binaries (glGetProgramBinary / glProgramBinary) in a directory, one file per program.
+//Entries are keyed by a hash of the shader sources, the defines and the driver (GL_VENDOR, GL_RENDERER, GL_VERSION),
+//so a driver update or an edited shader just misses the cache.
+//
+//File: "VCSHADER", version, key, binary format, binary size, binary. Named after the key: <directory>/<key hex>.glbin
+//
+//Needs GL 4.1 / ARB_get_program_binary and at least one binary format, otherwise load misses and store does nothing.
+class ShaderBinaryCache
+{
+private:
+	ShaderBinaryCache();
+	~ShaderBinaryCache();
+
+public:
+	static const uint32_t VERSION = 1;
+
+	//"" disables the cache. Default: "assets/shaders/cache"
+	static void setDirectory(const std::string& directory);
+	static const std::string& getDirectory();
+	static bool isSupported();
+
+	static uint64_t makeKey(const std::string& vscode, const std::string& fscode, const std::string& defines);
+	//Creates a program from the cached binary. Returns 0 if there is no entry or the driver rejects it.
+	static GLuint load(uint64_t key);
+	//Writes the binary of a linked program. The program must have been linked with
+	//GL_PROGRAM_BINARY_RETRIEVABLE_HINT set. Failures are ignored, the cache is only an optimization.
+	static void store(uint64_t key, GLuint program);
+	//call between glCreateProgram and glLinkProgram of programs that will be stored
+	static void prepareLink(GLuint program);
+
+private:
+	static std::string getPath(uint64_t key);
+};
+
+#endif
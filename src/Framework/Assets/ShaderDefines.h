@@ -0,0 +1,54 @@
+#ifndef _SHADER_DEFINES_H_
+#define _SHADER_DEFINES_H_
+#include <map>
+#include <string>
+
+//Set of preprocessor defines that selects a shader variant (i.e. INSTANCED, SKINNING, NO_LIGHTING).
+//Kept sorted, so the same set always gives the same key no matter in which order it was built.
+class ShaderDefines
+{
+public:
+	ShaderDefines() {}
+
+	//chainable: ShaderDefines().set("INSTANCED").set("MAX_BONES", "64")
+	ShaderDefines& set(const std::string& name, const std::string& value = "1")
+	{
+		m_defines[name] = value;
+		return *this;
+	}
+	ShaderDefines& unset(const std::string& name)
+	{
+		m_defines.erase(name);
+		return *this;
+	}
+	bool isSet(const std::string& name) const
+	{
+		return m_defines.find(name) != m_defines.end();
+	}
+	bool empty() const
+	{
+		return m_defines.empty();
+	}
+
+	//"#define NAME VALUE" lines for AssetManager::injectDefines
+	std::string toSource() const
+	{
+		std::string source;
+		for (const auto& define : m_defines)
+			source.append("#define " + define.first + " " + define.second + "\n");
+		return source;
+	}
+	//canonical "NAME=VALUE;NAME=VALUE"
+	std::string toKey() const
+	{
+		std::string key;
+		for (const auto& define : m_defines)
+			key.append(define.first + "=" + define.second + ";");
+		return key;
+	}
+
+private:
+	std::map<std::string, std::string> m_defines;
+};
+
+#endif
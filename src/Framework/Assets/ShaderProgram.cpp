@@ -1,6 +1,5 @@
 #include "ShaderProgram.h"
-
-
+#include <vector>
 
 ShaderProgram::ShaderProgram() :
 	prog(0),
@@ -10,11 +9,16 @@ ShaderProgram::ShaderProgram() :
 ShaderProgram::ShaderProgram(GLuint program) :
 	prog(program),
 	currentTu(0)
-{}
+{
+	reflectUniforms();
+	reflectUniformBlocks();
+}
 
 ShaderProgram::ShaderProgram(ShaderProgram && other) :
 	prog(other.prog),
-	currentTu(0)
+	currentTu(0),
+	m_uniforms(std::move(other.m_uniforms)),
+	m_blocks(std::move(other.m_blocks))
 {
 	other.prog = 0;
 }
@@ -24,29 +28,27 @@ ShaderProgram & ShaderProgram::operator=(ShaderProgram && other)
 	if (this == &other)
 		return *this;
 
-	if(prog)
-		glDeleteProgram(prog);
+	GLStateCache::deleteProgram(prog);
 
 	prog = other.prog;
 	other.prog = 0;
 	currentTu = other.currentTu;
+	m_uniforms = std::move(other.m_uniforms);
+	m_blocks = std::move(other.m_blocks);
 
 	return *this;
 }
 
 ShaderProgram::~ShaderProgram()
 {
-	if(prog)
-		glDeleteProgram(prog);
+	GLStateCache::deleteProgram(prog);
 }
 
 void ShaderProgram::use()
 {
 	resetTU();
-	GLint current;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &current); GLERR
-		if (current != prog && prog != 0)
-			glUseProgram(prog); GLERR
+	if (prog != 0)
+		GLStateCache::useProgram(prog);
 }
 
 GLuint ShaderProgram::getFreeTU()
@@ -63,3 +65,109 @@ void ShaderProgram::resetTU(GLuint tu)
 {
 	currentTu = tu;
 }
+
+void ShaderProgram::reflectUniforms()
+{
+	m_uniforms.clear();
+	if (!prog)
+		return;
+	GLint count = 0;
+	GLint maxlength = 0;
+	glGetProgramiv(prog, GL_ACTIVE_UNIFORMS, &count); GLERR
+	glGetProgramiv(prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxlength); GLERR
+	std::vector<GLchar> buffer(static_cast<size_t>(maxlength) + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(prog, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data()); GLERR
+		std::string name(buffer.data(), static_cast<size_t>(length));
+		//members of uniform blocks have no location
+		GLint location = glGetUniformLocation(prog, name.c_str()); GLERR
+		if (location == -1)
+			continue;
+		m_uniforms[name] = location;
+
+		//arrays are reported as "name[0]": add the plain name and the other elements
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		{
+			std::string base = name.substr(0, name.size() - 3);
+			m_uniforms[base] = location;
+			for (GLint e = 1; e < size; e++)
+			{
+				std::string element = base + "[" + std::to_string(e) + "]";
+				GLint elementlocation = glGetUniformLocation(prog, element.c_str()); GLERR
+				if (elementlocation != -1)
+					m_uniforms[element] = elementlocation;
+			}
+		}
+	}
+}
+
+bool ShaderProgram::setUniformBlockBinding(const std::string & name, GLuint binding)
+{
+	auto it = m_blocks.find(name);
+	if (it == m_blocks.end())
+		return false;
+	glUniformBlockBinding(prog, it->second.index, binding); GLERR
+	it->second.binding = binding;
+	return true;
+}
+
+void ShaderProgram::reflectUniformBlocks()
+{
+	m_blocks.clear();
+	if (!prog)
+		return;
+	GLint count = 0;
+	GLint maxlength = 0;
+	glGetProgramiv(prog, GL_ACTIVE_UNIFORM_BLOCKS, &count); GLERR
+	glGetProgramiv(prog, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxlength); GLERR
+	std::vector<GLchar> buffer(static_cast<size_t>(maxlength) + 1);
+	for (GLint b = 0; b < count; b++)
+	{
+		GLuint index = static_cast<GLuint>(b);
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(prog, index, static_cast<GLsizei>(buffer.size()), &length, buffer.data()); GLERR
+		std::string blockname(buffer.data(), static_cast<size_t>(length));
+
+		UniformBlock& block = m_blocks[blockname];
+		GLint binding = 0;
+		GLint membercount = 0;
+		block.index = index;
+		glGetActiveUniformBlockiv(prog, index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize); GLERR
+		glGetActiveUniformBlockiv(prog, index, GL_UNIFORM_BLOCK_BINDING, &binding); GLERR
+		glGetActiveUniformBlockiv(prog, index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &membercount); GLERR
+		block.binding = static_cast<GLuint>(binding);
+		if (membercount <= 0)
+			continue;
+
+		std::vector<GLint> indices(static_cast<size_t>(membercount));
+		glGetActiveUniformBlockiv(prog, index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data()); GLERR
+		std::vector<GLuint> uindices(indices.begin(), indices.end());
+		std::vector<GLint> offsets(uindices.size()), types(uindices.size()), sizes(uindices.size()), arraystrides(uindices.size()), matrixstrides(uindices.size());
+		glGetActiveUniformsiv(prog, membercount, uindices.data(), GL_UNIFORM_OFFSET, offsets.data()); GLERR
+		glGetActiveUniformsiv(prog, membercount, uindices.data(), GL_UNIFORM_TYPE, types.data()); GLERR
+		glGetActiveUniformsiv(prog, membercount, uindices.data(), GL_UNIFORM_SIZE, sizes.data()); GLERR
+		glGetActiveUniformsiv(prog, membercount, uindices.data(), GL_UNIFORM_ARRAY_STRIDE, arraystrides.data()); GLERR
+		glGetActiveUniformsiv(prog, membercount, uindices.data(), GL_UNIFORM_MATRIX_STRIDE, matrixstrides.data()); GLERR
+
+		GLint maxmemberlength = 0;
+		glGetProgramiv(prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxmemberlength); GLERR
+		std::vector<GLchar> membername(static_cast<size_t>(maxmemberlength) + 1);
+		for (size_t m = 0; m < uindices.size(); m++)
+		{
+			glGetActiveUniformName(prog, uindices[m], static_cast<GLsizei>(membername.size()), &length, membername.data()); GLERR
+			std::string name(membername.data(), static_cast<size_t>(length));
+			//members of blocks with an instance name are reported as "BlockName.member"
+			if (name.compare(0, blockname.size() + 1, blockname + ".") == 0)
+				name.erase(0, blockname.size() + 1);
+
+			UniformBlock::Member member{ offsets[m], static_cast<GLenum>(types[m]), sizes[m], arraystrides[m], matrixstrides[m] };
+			block.members[name] = member;
+			if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+				block.members[name.substr(0, name.size() - 3)] = member;
+		}
+	}
+}
@@ -2,8 +2,88 @@
 #define _SHADER_PROGRAM_H_
 #include <libheaders.h>
 #include <glerror.h>
+#include <GLStateCache.h>
+#include <unordered_map>
+#include <string>
+#include <cstring>
 
+//location of an active uniform of one program, see ShaderProgram::getUniformHandle
+class UniformHandle
+{
+public:
+	UniformHandle() : location(-1), program(0) {}
+	UniformHandle(GLint loc, GLuint prg) : location(loc), program(prg) {}
+
+	bool valid() const
+	{
+		return location != -1;
+	}
+
+	GLint location;
+	GLuint program;
+};
+
+//std140 layout of a uniform block as reported by the driver, see ShaderProgram::getUniformBlock
+class UniformBlock
+{
+public:
+	class Member
+	{
+	public:
+		GLint offset;			//bytes from the start of the block
+		GLenum type;
+		GLint size;				//array length, 1 for non arrays
+		GLint arrayStride;
+		GLint matrixStride;		//distance between matrix columns
+	};
+
+	GLuint index = 0;
+	GLint dataSize = 0;			//bytes needed for one instance of the block
+	GLuint binding = 0;
+	//members by name without the block name prefix. Arrays are found as "name" and "name[0]".
+	std::unordered_map<std::string, Member> members;
+
+	const Member* getMember(const std::string& name) const
+	{
+		auto it = members.find(name);
+		return it == members.end() ? nullptr : &it->second;
+	}
+
+	//Write value to member in the block data at data. Returns false if the member doesn't exist.
+	//Scalars, vectors and mat4 are copied as is, mat2/mat3 columns are placed at matrixStride.
+	template <typename T>
+	bool write(void* data, const std::string& name, const T& value) const
+	{
+		const Member* member = getMember(name);
+		if (!member)
+			return false;
+		std::memcpy(static_cast<char*>(data) + member->offset, &value, sizeof(T));
+		return true;
+	}
+	bool write(void* data, const std::string& name, const glm::mat2& value) const
+	{
+		return writeColumns(data, name, &value[0], 2);
+	}
+	bool write(void* data, const std::string& name, const glm::mat3& value) const
+	{
+		return writeColumns(data, name, &value[0], 3);
+	}
+
+private:
+	template <typename V>
+	bool writeColumns(void* data, const std::string& name, const V* columns, int count) const
+	{
+		const Member* member = getMember(name);
+		if (!member)
+			return false;
+		for (int c = 0; c < count; c++)
+			std::memcpy(static_cast<char*>(data) + member->offset + c * member->matrixStride, &columns[c], sizeof(V));
+		return true;
+	}
+};
 
+//The active uniforms are reflected once when the program is created, so setUniform doesn't query GL.
+//The bound program is tracked by GLStateCache: programs must not be bound with glUseProgram directly.
 class ShaderProgram
 {
 public:
@@ -20,19 +100,36 @@ public:
 
 	bool isActive()
 	{
-		if (!prog)
-			return false;
-		GLint progName = 0;
-		glGetIntegerv(GL_CURRENT_PROGRAM, &progName); GLERR
-			if (progName != this->prog)
-				return false;
-		return true;
+		return prog != 0 && GLStateCache::getProgram() == prog;
 	}
 
 	GLuint getFreeTU();
 	GLuint getCurrentTU();
 	void resetTU(GLuint tu = 0u);
 
+	//Resolve uniforms once (i.e. after loading) and pass the handle to setUniform in the render loop.
+	//Arrays are found by their name, "name[0]" and "name[i]". Invalid if the uniform isn't active.
+	UniformHandle getUniformHandle(const std::string& name) const
+	{
+		auto it = m_uniforms.find(name);
+		if (it == m_uniforms.end())
+			return UniformHandle();
+		return UniformHandle(it->second, prog);
+	}
+
+	//uniform blocks by block name (not instance name), reflected when the program is created
+	const UniformBlock* getUniformBlock(const std::string& name) const
+	{
+		auto it = m_blocks.find(name);
+		return it == m_blocks.end() ? nullptr : &it->second;
+	}
+	const std::unordered_map<std::string, UniformBlock>& getUniformBlocks() const
+	{
+		return m_blocks;
+	}
+	//glUniformBlockBinding. Returns false if the block isn't active.
+	bool setUniformBlockBinding(const std::string& name, GLuint binding);
+
 	bool setUniform(const std::string& name, GLfloat value);
 	bool setUniform(const std::string& name, const glm::vec2& value);
 	bool setUniform(const std::string& name, const glm::vec3& value);
@@ -52,177 +149,226 @@ public:
 	bool setUniform(const std::string& name, const glm::mat3& value, bool transpose);
 	bool setUniform(const std::string& name, const glm::mat4& value, bool transpose);
 
+	bool setUniform(UniformHandle uniform, GLfloat value);
+	bool setUniform(UniformHandle uniform, const glm::vec2& value);
+	bool setUniform(UniformHandle uniform, const glm::vec3& value);
+	bool setUniform(UniformHandle uniform, const glm::vec4& value);
+
+	bool setUniform(UniformHandle uniform, GLint value);
+	bool setUniform(UniformHandle uniform, const glm::ivec2& value);
+	bool setUniform(UniformHandle uniform, const glm::ivec3& value);
+	bool setUniform(UniformHandle uniform, const glm::ivec4& value);
+
+	bool setUniform(UniformHandle uniform, GLuint value);
+	bool setUniform(UniformHandle uniform, const glm::uvec2& value);
+	bool setUniform(UniformHandle uniform, const glm::uvec3& value);
+	bool setUniform(UniformHandle uniform, const glm::uvec4& value);
+
+	bool setUniform(UniformHandle uniform, const glm::mat2& value, bool transpose);
+	bool setUniform(UniformHandle uniform, const glm::mat3& value, bool transpose);
+	bool setUniform(UniformHandle uniform, const glm::mat4& value, bool transpose);
+
 private:
-	GLint getUniformLocation(const char* name)
-	{
-		if (!prog)
-			return -1;
-		return glGetUniformLocation(this->prog, name); GLERR
-	}
+	//name -> location of all active uniforms outside of uniform blocks
+	std::unordered_map<std::string, GLint> m_uniforms;
+	std::unordered_map<std::string, UniformBlock> m_blocks;
+
+	void reflectUniforms();
+	void reflectUniformBlocks();
 };
 
 inline bool ShaderProgram::setUniform(const std::string& name, GLfloat value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, GLfloat value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform1f(loc, value); GLERR
+	glUniform1f(uniform.location, value); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::vec2& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::vec2& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform2fv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform2fv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::vec3& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::vec3& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform3fv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform3fv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::vec4& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::vec4& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform4fv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform4fv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, GLint value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, GLint value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform1i(loc, value); GLERR
+	glUniform1i(uniform.location, value); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::ivec2& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::ivec2& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform2iv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform2iv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::ivec3& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::ivec3& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform3iv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform3iv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::ivec4& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::ivec4& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform4iv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform4iv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, GLuint value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, GLuint value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform1ui(loc, value); GLERR
+	glUniform1ui(uniform.location, value); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::uvec2& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::uvec2& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform2uiv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform2uiv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::uvec3& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::uvec3& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform3uiv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform3uiv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::uvec4& value)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::uvec4& value)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniform4uiv(loc, 1, glm::value_ptr(value)); GLERR
+	glUniform4uiv(uniform.location, 1, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::mat2& value, bool transpose)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value, transpose);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::mat2& value, bool transpose)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniformMatrix2fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(value)); GLERR
+	glUniformMatrix2fv(uniform.location, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::mat3& value, bool transpose)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value, transpose);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::mat3& value, bool transpose)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniformMatrix3fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(value)); GLERR
+	glUniformMatrix3fv(uniform.location, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(value)); GLERR
 		return true;
 }
 
 inline bool ShaderProgram::setUniform(const std::string& name, const glm::mat4& value, bool transpose)
 {
-	GLint loc = getUniformLocation(name.c_str());
-	if (loc == -1)
-		return false;
-	if (!isActive())
+	return setUniform(getUniformHandle(name), value, transpose);
+}
+
+inline bool ShaderProgram::setUniform(UniformHandle uniform, const glm::mat4& value, bool transpose)
+{
+	if (uniform.location == -1 || uniform.program != prog || !isActive())
 		return false;
-	glUniformMatrix4fv(loc, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(value)); GLERR
+	glUniformMatrix4fv(uniform.location, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(value)); GLERR
 		return true;
 }
 
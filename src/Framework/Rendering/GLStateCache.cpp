@@ -0,0 +1,418 @@
+#include "GLStateCache.h"
+
+namespace
+{
+	//value of a binding or setting that isn't known
+	const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+	const GLenum BUFFER_TARGETS[] = {
+		GL_ARRAY_BUFFER,
+		GL_ELEMENT_ARRAY_BUFFER,
+		GL_UNIFORM_BUFFER,
+		GL_DRAW_INDIRECT_BUFFER,
+		GL_COPY_READ_BUFFER,
+		GL_COPY_WRITE_BUFFER,
+		GL_PIXEL_PACK_BUFFER,
+		GL_PIXEL_UNPACK_BUFFER,
+		GL_TEXTURE_BUFFER,
+		GL_SHADER_STORAGE_BUFFER
+	};
+	const size_t BUFFER_TARGET_COUNT = sizeof(BUFFER_TARGETS) / sizeof(BUFFER_TARGETS[0]);
+
+	const GLenum TEXTURE_TARGETS[] = {
+		GL_TEXTURE_2D,
+		GL_TEXTURE_2D_ARRAY,
+		GL_TEXTURE_CUBE_MAP,
+		GL_TEXTURE_3D,
+		GL_TEXTURE_2D_MULTISAMPLE,
+		GL_TEXTURE_BUFFER
+	};
+	const size_t TEXTURE_TARGET_COUNT = sizeof(TEXTURE_TARGETS) / sizeof(TEXTURE_TARGETS[0]);
+
+	const GLenum CAPABILITIES[] = {
+		GL_CULL_FACE,
+		GL_DEPTH_TEST,
+		GL_BLEND,
+		GL_SCISSOR_TEST,
+		GL_STENCIL_TEST,
+		GL_MULTISAMPLE,
+		GL_POLYGON_OFFSET_FILL,
+		GL_FRAMEBUFFER_SRGB,
+		GL_PRIMITIVE_RESTART
+	};
+	const size_t CAPABILITY_COUNT = sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]);
+
+	//returns count if value isn't in the list
+	size_t slotOf(const GLenum* list, size_t count, GLenum value)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			if (list[i] == value)
+				return i;
+		}
+		return count;
+	}
+
+	struct IndexedBinding
+	{
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;	//-1: whole buffer (glBindBufferBase)
+	};
+
+	struct State
+	{
+		GLuint program;
+		GLuint vao;
+		GLuint buffers[BUFFER_TARGET_COUNT];
+		IndexedBinding uniformBuffers[GLStateCache::MAX_UNIFORM_BUFFER_BINDINGS];
+		GLuint activeUnit;
+		GLuint textures[GLStateCache::MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+		GLuint enabled[CAPABILITY_COUNT];	//0, 1 or UNKNOWN
+		GLenum cullFace;
+		GLenum frontFace;
+		GLenum depthFunc;
+		GLuint depthMask;
+		GLenum blendSrc;
+		GLenum blendDst;
+		GLenum blendEquation;
+	};
+
+	State state;
+	GLStateCache::Stats currentStats;
+	GLStateCache::Stats frameStats;
+	bool initialized = false;
+
+	void reset()
+	{
+		state.program = UNKNOWN;
+		state.vao = UNKNOWN;
+		for (auto& b : state.buffers)
+			b = UNKNOWN;
+		for (auto& b : state.uniformBuffers)
+			b = IndexedBinding{ UNKNOWN, 0, 0 };
+		state.activeUnit = UNKNOWN;
+		for (auto& unit : state.textures)
+		{
+			for (auto& t : unit)
+				t = UNKNOWN;
+		}
+		for (auto& e : state.enabled)
+			e = UNKNOWN;
+		state.cullFace = UNKNOWN;
+		state.frontFace = UNKNOWN;
+		state.depthFunc = UNKNOWN;
+		state.depthMask = UNKNOWN;
+		state.blendSrc = UNKNOWN;
+		state.blendDst = UNKNOWN;
+		state.blendEquation = UNKNOWN;
+		initialized = true;
+	}
+
+	//true if value differs from the shadowed one, which is updated. Counts the call.
+	template <typename T>
+	bool change(T& shadowed, T value)
+	{
+		if (!initialized)
+			reset();
+		if (shadowed == value)
+		{
+			currentStats.elided++;
+			return false;
+		}
+		shadowed = value;
+		currentStats.issued++;
+		return true;
+	}
+
+	//for calls that aren't cached
+	void passThrough()
+	{
+		if (!initialized)
+			reset();
+		currentStats.issued++;
+	}
+
+	void unbindBuffer(GLuint buffer)
+	{
+		for (auto& b : state.buffers)
+		{
+			if (b == buffer)
+				b = 0;
+		}
+		for (auto& b : state.uniformBuffers)
+		{
+			if (b.buffer == buffer)
+				b = IndexedBinding{ 0, 0, -1 };
+		}
+	}
+}
+
+void GLStateCache::invalidate()
+{
+	reset();
+}
+
+void GLStateCache::beginFrame()
+{
+	frameStats = currentStats;
+	currentStats = Stats();
+}
+
+const GLStateCache::Stats & GLStateCache::getFrameStats()
+{
+	return frameStats;
+}
+
+const GLStateCache::Stats & GLStateCache::getCurrentStats()
+{
+	return currentStats;
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+	if (change(state.program, program))
+	{
+		glUseProgram(program); GLERR
+	}
+}
+
+GLuint GLStateCache::getProgram()
+{
+	if (!initialized)
+		reset();
+	return state.program;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+	if (change(state.vao, vao))
+	{
+		glBindVertexArray(vao); GLERR
+		state.buffers[slotOf(BUFFER_TARGETS, BUFFER_TARGET_COUNT, GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+	}
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+	size_t slot = slotOf(BUFFER_TARGETS, BUFFER_TARGET_COUNT, target);
+	if (slot == BUFFER_TARGET_COUNT)
+	{
+		passThrough();
+		glBindBuffer(target, buffer); GLERR
+		return;
+	}
+	if (change(state.buffers[slot], buffer))
+	{
+		glBindBuffer(target, buffer); GLERR
+	}
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	if (target == GL_UNIFORM_BUFFER && index < MAX_UNIFORM_BUFFER_BINDINGS)
+	{
+		IndexedBinding& b = state.uniformBuffers[index];
+		if (!initialized)
+			reset();
+		if (b.buffer == buffer && b.size == -1)
+		{
+			currentStats.elided++;
+			return;
+		}
+		b = IndexedBinding{ buffer, 0, -1 };
+	}
+	passThrough();
+	glBindBufferBase(target, index, buffer); GLERR
+	size_t slot = slotOf(BUFFER_TARGETS, BUFFER_TARGET_COUNT, target);
+	if (slot != BUFFER_TARGET_COUNT)
+		state.buffers[slot] = buffer;
+}
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	if (target == GL_UNIFORM_BUFFER && index < MAX_UNIFORM_BUFFER_BINDINGS)
+	{
+		IndexedBinding& b = state.uniformBuffers[index];
+		if (!initialized)
+			reset();
+		if (b.buffer == buffer && b.offset == offset && b.size == size)
+		{
+			currentStats.elided++;
+			return;
+		}
+		b = IndexedBinding{ buffer, offset, size };
+	}
+	passThrough();
+	glBindBufferRange(target, index, buffer, offset, size); GLERR
+	size_t slot = slotOf(BUFFER_TARGETS, BUFFER_TARGET_COUNT, target);
+	if (slot != BUFFER_TARGET_COUNT)
+		state.buffers[slot] = buffer;
+}
+
+void GLStateCache::activeTexture(GLuint unit)
+{
+	if (change(state.activeUnit, unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit); GLERR
+	}
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	size_t slot = slotOf(TEXTURE_TARGETS, TEXTURE_TARGET_COUNT, target);
+	if (unit >= MAX_TEXTURE_UNITS || slot == TEXTURE_TARGET_COUNT)
+	{
+		activeTexture(unit);
+		passThrough();
+		glBindTexture(target, texture); GLERR
+		return;
+	}
+	if (!initialized)
+		reset();
+	if (state.textures[unit][slot] == texture)
+	{
+		currentStats.elided++;
+		return;
+	}
+	activeTexture(unit);
+	state.textures[unit][slot] = texture;
+	currentStats.issued++;
+	glBindTexture(target, texture); GLERR
+}
+
+void GLStateCache::enable(GLenum cap)
+{
+	setEnabled(cap, true);
+}
+
+void GLStateCache::disable(GLenum cap)
+{
+	setEnabled(cap, false);
+}
+
+void GLStateCache::setEnabled(GLenum cap, bool enabled)
+{
+	size_t slot = slotOf(CAPABILITIES, CAPABILITY_COUNT, cap);
+	if (slot == CAPABILITY_COUNT)
+	{
+		passThrough();
+	}
+	else if (!change(state.enabled[slot], enabled ? 1u : 0u))
+	{
+		return;
+	}
+	if (enabled)
+		glEnable(cap);
+	else
+		glDisable(cap);
+	GLERR
+}
+
+void GLStateCache::cullFace(GLenum mode)
+{
+	if (change(state.cullFace, mode))
+	{
+		glCullFace(mode); GLERR
+	}
+}
+
+void GLStateCache::frontFace(GLenum mode)
+{
+	if (change(state.frontFace, mode))
+	{
+		glFrontFace(mode); GLERR
+	}
+}
+
+void GLStateCache::depthFunc(GLenum func)
+{
+	if (change(state.depthFunc, func))
+	{
+		glDepthFunc(func); GLERR
+	}
+}
+
+void GLStateCache::depthMask(GLboolean flag)
+{
+	if (change(state.depthMask, static_cast<GLuint>(flag ? GL_TRUE : GL_FALSE)))
+	{
+		glDepthMask(flag); GLERR
+	}
+}
+
+void GLStateCache::blendFunc(GLenum sfactor, GLenum dfactor)
+{
+	if (!initialized)
+		reset();
+	if (state.blendSrc == sfactor && state.blendDst == dfactor)
+	{
+		currentStats.elided++;
+		return;
+	}
+	state.blendSrc = sfactor;
+	state.blendDst = dfactor;
+	currentStats.issued++;
+	glBlendFunc(sfactor, dfactor); GLERR
+}
+
+void GLStateCache::blendEquation(GLenum mode)
+{
+	if (change(state.blendEquation, mode))
+	{
+		glBlendEquation(mode); GLERR
+	}
+}
+
+void GLStateCache::deleteProgram(GLuint program)
+{
+	if (!program)
+		return;
+	if (!initialized)
+		reset();
+	glDeleteProgram(program); GLERR
+	//a bound program is only flagged for deletion, force the next useProgram through
+	if (state.program == program)
+		state.program = UNKNOWN;
+}
+
+void GLStateCache::deleteVertexArray(GLuint vao)
+{
+	if (!vao)
+		return;
+	if (!initialized)
+		reset();
+	glDeleteVertexArrays(1, &vao); GLERR
+	if (state.vao == vao)
+	{
+		state.vao = 0;
+		state.buffers[slotOf(BUFFER_TARGETS, BUFFER_TARGET_COUNT, GL_ELEMENT_ARRAY_BUFFER)] = 0;
+	}
+}
+
+void GLStateCache::deleteBuffer(GLuint buffer)
+{
+	if (!buffer)
+		return;
+	if (!initialized)
+		reset();
+	glDeleteBuffers(1, &buffer); GLERR
+	unbindBuffer(buffer);
+}
+
+void GLStateCache::deleteTexture(GLuint texture)
+{
+	if (!texture)
+		return;
+	if (!initialized)
+		reset();
+	glDeleteTextures(1, &texture); GLERR
+	for (auto& unit : state.textures)
+	{
+		for (auto& t : unit)
+		{
+			if (t == texture)
+				t = 0;
+		}
+	}
+}
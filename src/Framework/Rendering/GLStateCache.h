@@ -0,0 +1,70 @@
+#ifndef _GL_STATE_CACHE_H_
+#define _GL_STATE_CACHE_H_
+#include <libheaders.h>
+#include <glerror.h>
+#include <cstddef>
+
+//Client side shadow of the GL binding and render state of the (single) context.
+//Calls that would not change the state are filtered without touching GL, so no glGet* is needed to find out.
+//All state starts unknown, the first call of every kind is always issued.
+//Code that changes the state past the cache must call invalidate() afterwards.
+class GLStateCache
+{
+private:
+	GLStateCache();
+	~GLStateCache();
+
+public:
+	static const GLuint MAX_TEXTURE_UNITS = 32;
+	static const GLuint MAX_UNIFORM_BUFFER_BINDINGS = 16;
+
+	class Stats
+	{
+	public:
+		size_t issued = 0;		//calls passed to GL
+		size_t elided = 0;		//redundant calls filtered by the cache
+	};
+
+	//forget all shadowed state
+	static void invalidate();
+	//starts counting a new frame
+	static void beginFrame();
+	//counters of the last completed frame
+	static const Stats& getFrameStats();
+	//counters since beginFrame
+	static const Stats& getCurrentStats();
+
+	//programs, vertex arrays and buffers
+	static void useProgram(GLuint program);
+	static GLuint getProgram();
+	//the element array buffer binding is part of the vertex array state and becomes unknown on a change
+	static void bindVertexArray(GLuint vao);
+	static void bindBuffer(GLenum target, GLuint buffer);
+	//also sets the generic binding of target, like GL does. Only uniform buffer bindings are cached.
+	static void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	//textures. unit is the index, not GL_TEXTURE0 + index.
+	static void activeTexture(GLuint unit);
+	//makes unit active and binds texture to target
+	static void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	//fixed function state
+	static void enable(GLenum cap);
+	static void disable(GLenum cap);
+	static void setEnabled(GLenum cap, bool enabled);
+	static void cullFace(GLenum mode);
+	static void frontFace(GLenum mode);
+	static void depthFunc(GLenum func);
+	static void depthMask(GLboolean flag);
+	static void blendFunc(GLenum sfactor, GLenum dfactor);
+	static void blendEquation(GLenum mode);
+
+	//delete the object and drop it from the shadowed bindings (GL unbinds deleted objects itself)
+	static void deleteProgram(GLuint program);
+	static void deleteVertexArray(GLuint vao);
+	static void deleteBuffer(GLuint buffer);
+	static void deleteTexture(GLuint texture);
+};
+
+#endif
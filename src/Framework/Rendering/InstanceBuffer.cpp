@@ -0,0 +1,81 @@
+#include "InstanceBuffer.h"
+#include <GLStateCache.h>
+#include <cstring>
+
+InstanceBuffer::InstanceBuffer() :
+	m_stream(new StreamBuffer(64 * sizeof(glm::mat4), sizeof(glm::mat4))),
+	m_capacity(64),
+	m_count(0),
+	m_offset(0),
+	m_fencePending(false)
+{}
+
+InstanceBuffer::~InstanceBuffer()
+{}
+
+void InstanceBuffer::pointAttributes(GLuint firstlocation, GLintptr offset)
+{
+	GLStateCache::bindBuffer(GL_ARRAY_BUFFER, m_stream->getBuffer());
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(firstlocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<const void*>(offset + column * sizeof(glm::vec4))); GLERR
+	}
+}
+
+void InstanceBuffer::attach(GLuint vao, GLuint firstlocation)
+{
+	GLStateCache::bindVertexArray(vao);
+	pointAttributes(firstlocation, m_offset);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		GLuint location = firstlocation + column;
+		glEnableVertexAttribArray(location); GLERR
+		glVertexAttribDivisor(location, 1); GLERR
+	}
+	GLStateCache::bindVertexArray(0);
+	m_attached.push_back(std::make_pair(vao, firstlocation));
+}
+
+void InstanceBuffer::setFirstInstance(size_t first, GLuint firstlocation)
+{
+	pointAttributes(firstlocation, m_offset + static_cast<GLintptr>(first * sizeof(glm::mat4)));
+}
+
+void InstanceBuffer::update(const glm::mat4 * matrices, size_t count)
+{
+	if (count > m_capacity)
+	{
+		//grow in steps to avoid reallocating every frame while the count rises.
+		//The old buffer is released by GL once the draws that still use it are done.
+		m_capacity = count + count / 2;
+		m_stream.reset(new StreamBuffer(static_cast<GLsizeiptr>(m_capacity * sizeof(glm::mat4)), sizeof(glm::mat4)));
+		m_fencePending = false;
+	}
+	else if (m_fencePending)
+	{
+		//the draws with the previous data have been issued by now
+		m_stream->endFrame();
+	}
+	m_stream->beginFrame();
+	StreamBuffer::Allocation allocation = m_stream->allocate(static_cast<GLsizeiptr>(count * sizeof(glm::mat4)));
+	if (count > 0)
+		std::memcpy(allocation.data, matrices, count * sizeof(glm::mat4));
+	m_stream->flush();
+	m_fencePending = true;
+	m_count = count;
+	m_offset = allocation.offset;
+
+	for (const auto& attached : m_attached)
+	{
+		GLStateCache::bindVertexArray(attached.first);
+		pointAttributes(attached.second, m_offset);
+	}
+	GLStateCache::bindVertexArray(0);
+}
+
+void InstanceBuffer::drawElements(GLenum mode, GLsizei indexcount, GLenum indextype, const void * indices)
+{
+	if (m_count == 0)
+		return;
+	glDrawElementsInstanced(mode, indexcount, indextype, indices, static_cast<GLsizei>(m_count)); GLERR
+}
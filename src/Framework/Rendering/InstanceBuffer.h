@@ -0,0 +1,56 @@
+#ifndef _INSTANCE_BUFFER_H_
+#define _INSTANCE_BUFFER_H_
+#include <libheaders.h>
+#include <glerror.h>
+#include <StreamBuffer.h>
+#include <cstddef>
+#include <vector>
+#include <memory>
+
+//Vertex buffer with one model matrix per instance for glDrawElementsInstanced.
+//The matrix is fed to four vec4 attributes (firstlocation .. firstlocation + 3) with divisor 1,
+//declared in the shader as "layout (location = 4) in mat4 instanceMatrix;".
+//The data is streamed through a StreamBuffer. Each update writes a new region and moves the attributes
+//of all attached vertex arrays there, the region of an update is fenced at the next update.
+class InstanceBuffer
+{
+public:
+	static const GLuint DEFAULT_LOCATION = 4;
+
+	InstanceBuffer();
+	~InstanceBuffer();
+	InstanceBuffer(const InstanceBuffer& other) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer& other) = delete;
+
+	//adds the instance attributes to vao. One buffer can be attached to several vertex arrays.
+	void attach(GLuint vao, GLuint firstlocation = DEFAULT_LOCATION);
+	//Replaces the instance data, at most once per frame. The GPU may still read the data of earlier updates.
+	//Leaves vertex array 0 bound.
+	void update(const glm::mat4* matrices, size_t count);
+	//Points the instance attributes of the bound vertex array at instance "first".
+	//Stands in for baseInstance where the context has no GL 4.2 / ARB_base_instance.
+	void setFirstInstance(size_t first, GLuint firstlocation = DEFAULT_LOCATION);
+	//one instanced draw of the bound vertex array for all instances of the last update
+	void drawElements(GLenum mode, GLsizei indexcount, GLenum indextype, const void* indices = nullptr);
+
+	size_t getCount() const
+	{
+		return m_count;
+	}
+	GLuint getBuffer() const
+	{
+		return m_stream->getBuffer();
+	}
+
+private:
+	std::unique_ptr<StreamBuffer> m_stream;
+	size_t m_capacity;	//instances per update
+	size_t m_count;
+	GLintptr m_offset;	//data of the last update
+	bool m_fencePending;	//the last update's region still needs its fence
+	std::vector<std::pair<GLuint, GLuint>> m_attached;	//vertex array, first location
+
+	void pointAttributes(GLuint firstlocation, GLintptr offset);
+};
+
+#endif
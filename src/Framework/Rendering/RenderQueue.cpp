@@ -0,0 +1,198 @@
+#include "RenderQueue.h"
+#include <GLStateCache.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+RenderQueue::RenderQueue(GLuint objectbinding, size_t maxpackets) :
+	m_objectBinding(objectbinding)
+{
+	//sized for ObjectData blocks that hold just the model matrix
+	GLsizeiptr blocksize = UniformBufferRing::alignedSize(sizeof(glm::mat4), UniformBufferRing::queryAlignment());
+	m_ring = std::unique_ptr<UniformBufferRing>(new UniformBufferRing(static_cast<GLsizeiptr>(maxpackets) * blocksize));
+	m_packets.reserve(maxpackets);
+}
+
+void RenderQueue::reserveRing(GLsizeiptr bytes)
+{
+	if (bytes <= m_ring->getCapacity())
+		return;
+	//the old buffer is released by GL once the frames in flight that read it are done
+	m_ring = std::unique_ptr<UniformBufferRing>(new UniformBufferRing(std::max(bytes, m_ring->getCapacity() * 2)));
+}
+
+void RenderQueue::submit(const DrawPacket & packet)
+{
+	m_packets.push_back(packet);
+}
+
+uint32_t RenderQueue::getId(std::unordered_map<GLuint, uint32_t>& ids, GLuint name, unsigned int bits)
+{
+	if (name == 0)
+		return 0;
+	auto it = ids.find(name);
+	if (it != ids.end())
+		return it->second;
+	//ids beyond the key range wrap around, that only weakens the grouping
+	uint32_t id = static_cast<uint32_t>(ids.size() + 1) & ((1u << bits) - 1u);
+	ids.insert(std::make_pair(name, id));
+	return id;
+}
+
+uint64_t RenderQueue::makeKey(const DrawPacket & packet)
+{
+	uint64_t program = getId(m_programIds, packet.shader ? packet.shader->prog : 0, PROGRAM_BITS);
+	uint64_t vao = getId(m_vaoIds, packet.vao, VAO_BITS);
+	uint64_t texture = getId(m_textureIds, packet.texture, TEXTURE_BITS);
+	const uint64_t maxdepth = (1ull << DEPTH_BITS) - 1ull;
+	uint64_t depth = static_cast<uint64_t>(std::min(std::max(packet.depth, 0.0f), 1.0f) * static_cast<float>(maxdepth));
+
+	uint64_t state = (program << (VAO_BITS + TEXTURE_BITS)) | (vao << TEXTURE_BITS) | texture;
+	if (packet.translucent)
+		return (1ull << 63) | ((maxdepth - depth) << (PROGRAM_BITS + VAO_BITS + TEXTURE_BITS)) | state;
+	return (state << DEPTH_BITS) | depth;
+}
+
+void RenderQueue::radixSort(std::vector<std::pair<uint64_t, uint32_t>>& items, std::vector<std::pair<uint64_t, uint32_t>>& scratch)
+{
+	if (items.size() < 2)
+		return;
+	//histograms of all eight digits in one read of the keys
+	uint32_t counts[8][256] = {};
+	for (const auto& item : items)
+	{
+		for (unsigned int digit = 0; digit < 8; digit++)
+			counts[digit][(item.first >> (digit * 8)) & 0xFF]++;
+	}
+	scratch.resize(items.size());
+	for (unsigned int digit = 0; digit < 8; digit++)
+	{
+		uint32_t* count = counts[digit];
+		//all keys have the same digit: nothing to do in this pass
+		if (count[(items[0].first >> (digit * 8)) & 0xFF] == items.size())
+			continue;
+		uint32_t sum = 0;
+		for (unsigned int i = 0; i < 256; i++)
+		{
+			uint32_t n = count[i];
+			count[i] = sum;
+			sum += n;
+		}
+		for (const auto& item : items)
+			scratch[count[(item.first >> (digit * 8)) & 0xFF]++] = item;
+		items.swap(scratch);
+	}
+}
+
+void RenderQueue::flush()
+{
+	try
+	{
+		draw();
+	}
+	catch (...)
+	{
+		//a failed frame must not stay queued for the next one
+		m_packets.clear();
+		throw;
+	}
+	m_packets.clear();
+}
+
+void RenderQueue::draw()
+{
+	m_stats = Stats();
+	m_stats.packets = m_packets.size();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	m_keys.resize(m_packets.size());
+	for (size_t i = 0; i < m_packets.size(); i++)
+		m_keys[i] = std::make_pair(makeKey(m_packets[i]), static_cast<uint32_t>(i));
+	radixSort(m_keys, m_scratch);
+	m_stats.sortTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	//ObjectData block of every packet and the ring space they need together
+	m_blocks.resize(m_keys.size());
+	const ShaderProgram* lastshader = nullptr;
+	std::pair<const UniformBlock*, GLint> block(nullptr, 0);
+	GLsizeiptr needed = 0;
+	for (size_t i = 0; i < m_keys.size(); i++)
+	{
+		const DrawPacket& packet = m_packets[m_keys[i].second];
+		if (packet.shader != lastshader)
+		{
+			lastshader = packet.shader;
+			const UniformBlock* objectblock = packet.shader ? packet.shader->getUniformBlock("ObjectData") : nullptr;
+			const UniformBlock::Member* member = objectblock ? objectblock->getMember("modelMatrix") : nullptr;
+			block.first = member ? objectblock : nullptr;
+			block.second = member ? member->offset : 0;
+		}
+		m_blocks[i] = block;
+		if (block.first)
+			needed += UniformBufferRing::alignedSize(block.first->dataSize, m_ring->getAlignment());
+	}
+	reserveRing(needed);
+
+	//all transforms in sorted order, uploaded at once
+	m_ring->beginFrame();
+	m_allocations.resize(m_keys.size());
+	for (size_t i = 0; i < m_keys.size(); i++)
+	{
+		if (!m_blocks[i].first)
+		{
+			m_allocations[i] = UniformBufferRing::Allocation();
+			continue;
+		}
+		m_allocations[i] = m_ring->allocate(m_blocks[i].first->dataSize);
+		std::memcpy(m_allocations[i].data + m_blocks[i].second, glm::value_ptr(m_packets[m_keys[i].second].transform), sizeof(glm::mat4));
+	}
+	m_ring->flush();
+
+	ShaderProgram* program = nullptr;
+	GLuint vao = 0xFFFFFFFFu;
+	GLuint texture = 0xFFFFFFFFu;
+	bool translucent = false;
+	for (size_t i = 0; i < m_keys.size(); i++)
+	{
+		const DrawPacket& packet = m_packets[m_keys[i].second];
+		if (m_allocations[i].size == 0)
+			continue;
+		if (packet.translucent != translucent)
+		{
+			//translucent packets come last, the switch happens once
+			translucent = packet.translucent;
+			GLStateCache::setEnabled(GL_BLEND, translucent);
+			GLStateCache::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			GLStateCache::depthMask(translucent ? GL_FALSE : GL_TRUE);
+		}
+		if (packet.shader != program)
+		{
+			program = packet.shader;
+			program->use();
+			m_stats.programChanges++;
+		}
+		if (packet.vao != vao)
+		{
+			vao = packet.vao;
+			GLStateCache::bindVertexArray(vao);
+			m_stats.vaoChanges++;
+		}
+		if (packet.texture != texture)
+		{
+			texture = packet.texture;
+			if (texture)
+				GLStateCache::bindTexture(0, GL_TEXTURE_2D, texture);
+			m_stats.textureChanges++;
+		}
+		m_ring->bind(m_objectBinding, m_allocations[i]);
+		glDrawElements(packet.mode, packet.indexCount, packet.indexType, reinterpret_cast<const void*>(packet.indexOffset)); GLERR
+		m_stats.drawCalls++;
+	}
+	if (translucent)
+	{
+		GLStateCache::disable(GL_BLEND);
+		GLStateCache::depthMask(GL_TRUE);
+	}
+	GLStateCache::bindVertexArray(0);
+	m_ring->endFrame();
+}
@@ -0,0 +1,90 @@
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+#include <libheaders.h>
+#include <ShaderProgram.h>
+#include <UniformBufferRing.h>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <memory>
+
+//everything needed for one indexed draw
+class DrawPacket
+{
+public:
+	ShaderProgram* shader = nullptr;	//needs an "ObjectData" uniform block with a "mat4 modelMatrix"
+	GLuint vao = 0;						//with the index buffer bound
+	GLuint texture = 0;					//material: GL_TEXTURE_2D on unit 0, 0 for none
+	bool translucent = false;			//drawn after all opaque packets, back to front
+	GLenum mode = GL_TRIANGLES;
+	GLsizei indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	GLintptr indexOffset = 0;			//bytes
+	glm::mat4 transform = glm::mat4(1.0f);
+	float depth = 0.0f;					//distance to the camera, 0 (near) .. 1 (far)
+};
+
+//Deferred draw submission. Packets are collected during the frame and flushed at once:
+//they are radix sorted by a 64 bit key, their transforms are written into one uniform buffer ring,
+//and the draws are issued with state changes only where the key changes.
+//
+//Key (opaque):		translucent = 0 | program (12) | vao (12) | texture (15) | depth (24), near first
+//Key (translucent):	translucent = 1 | inverted depth (24) | program (12) | vao (12) | texture (15), far first
+//Program, vao and texture are small ids the queue assigns on first use, not GL names.
+class RenderQueue
+{
+public:
+	static const unsigned int PROGRAM_BITS = 12;
+	static const unsigned int VAO_BITS = 12;
+	static const unsigned int TEXTURE_BITS = 15;
+	static const unsigned int DEPTH_BITS = 24;
+
+	class Stats
+	{
+	public:
+		size_t packets = 0;
+		size_t drawCalls = 0;
+		size_t programChanges = 0;
+		size_t vaoChanges = 0;
+		size_t textureChanges = 0;
+		double sortTime = 0.0;		//milliseconds
+	};
+
+	//objectbinding: uniform block binding of "ObjectData". maxpackets: initial capacity of the transform ring per frame,
+	//the ring grows when a frame submits more.
+	RenderQueue(GLuint objectbinding, size_t maxpackets = 16384);
+
+	void submit(const DrawPacket& packet);
+	//sorts and draws all submitted packets and empties the queue, also when it throws. Call once per frame.
+	void flush();
+
+	//statistics of the last flush
+	const Stats& getStats() const
+	{
+		return m_stats;
+	}
+
+	uint64_t makeKey(const DrawPacket& packet);
+	//LSD radix sort of (key, index) pairs by key, 8 bits per pass. Passes where all keys share the digit are skipped.
+	static void radixSort(std::vector<std::pair<uint64_t, uint32_t>>& items, std::vector<std::pair<uint64_t, uint32_t>>& scratch);
+
+private:
+	GLuint m_objectBinding;
+	std::unique_ptr<UniformBufferRing> m_ring;
+	std::vector<DrawPacket> m_packets;
+	std::vector<std::pair<uint64_t, uint32_t>> m_keys;
+	std::vector<std::pair<uint64_t, uint32_t>> m_scratch;
+	std::vector<UniformBufferRing::Allocation> m_allocations;
+	std::vector<std::pair<const UniformBlock*, GLint>> m_blocks;	//ObjectData block and modelMatrix offset per sorted packet
+	std::unordered_map<GLuint, uint32_t> m_programIds;
+	std::unordered_map<GLuint, uint32_t> m_vaoIds;
+	std::unordered_map<GLuint, uint32_t> m_textureIds;
+	Stats m_stats;
+
+	void draw();
+	//replaces the ring with a larger one if a frame needs more than its capacity
+	void reserveRing(GLsizeiptr bytes);
+	static uint32_t getId(std::unordered_map<GLuint, uint32_t>& ids, GLuint name, unsigned int bits);
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "SkinnedMeshBatch.h"
+#include <GLStateCache.h>
+#include <algorithm>
+#include <cstring>
+
+SkinnedMeshBatch::SkinnedMeshBatch(GLuint binding, uint32_t jointcount, uint32_t palettesize, size_t maxinstances) :
+	m_binding(binding),
+	m_jointCount(jointcount),
+	m_paletteSize(palettesize),
+	m_instancesPerDraw(jointcount > 0 ? palettesize / jointcount : 0),
+	m_maxInstances(maxinstances),
+	m_drawCalls(0)
+{
+	if (m_instancesPerDraw == 0)
+		throw std::logic_error("Skin palette too small for one instance.");
+	size_t draws = (maxinstances + m_instancesPerDraw - 1) / m_instancesPerDraw;
+	//every draw binds the whole array, the bound range must not be smaller than the block
+	GLsizeiptr blocksize = UniformBufferRing::alignedSize(static_cast<GLsizeiptr>(palettesize * sizeof(glm::mat4)), UniformBufferRing::queryAlignment());
+	m_ring = std::unique_ptr<UniformBufferRing>(new UniformBufferRing(static_cast<GLsizeiptr>(draws) * blocksize));
+	m_palettes.reserve(maxinstances * jointcount);
+}
+
+void SkinnedMeshBatch::clear()
+{
+	m_palettes.clear();
+}
+
+glm::mat4 * SkinnedMeshBatch::addInstance()
+{
+	if (getInstanceCount() >= m_maxInstances)
+		throw std::logic_error("Too many instances in skinned mesh batch.");
+	m_palettes.resize(m_palettes.size() + m_jointCount);
+	return &m_palettes[m_palettes.size() - m_jointCount];
+}
+
+void SkinnedMeshBatch::draw(GLuint vao, GLenum mode, GLsizei indexcount, GLenum indextype, const void * indices)
+{
+	m_drawCalls = 0;
+	size_t count = getInstanceCount();
+	if (count == 0)
+		return;
+
+	//all palettes first, one upload
+	m_ring->beginFrame();
+	m_allocations.clear();
+	for (size_t first = 0; first < count; first += m_instancesPerDraw)
+	{
+		size_t instances = std::min<size_t>(m_instancesPerDraw, count - first);
+		UniformBufferRing::Allocation allocation = m_ring->allocate(static_cast<GLsizeiptr>(m_paletteSize * sizeof(glm::mat4)));
+		//std140 mat4 arrays are tightly packed columns, same as glm. The unused tail is left as it is.
+		std::memcpy(allocation.data, &m_palettes[first * m_jointCount], instances * m_jointCount * sizeof(glm::mat4));
+		m_allocations.push_back(allocation);
+	}
+	m_ring->flush();
+
+	GLStateCache::bindVertexArray(vao);
+	for (size_t d = 0; d < m_allocations.size(); d++)
+	{
+		GLsizei instances = static_cast<GLsizei>(std::min<size_t>(m_instancesPerDraw, count - d * m_instancesPerDraw));
+		m_ring->bind(m_binding, m_allocations[d]);
+		glDrawElementsInstanced(mode, indexcount, indextype, indices, instances); GLERR
+		m_drawCalls++;
+	}
+	GLStateCache::bindVertexArray(0);
+	m_ring->endFrame();
+}
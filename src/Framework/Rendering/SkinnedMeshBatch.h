@@ -0,0 +1,56 @@
+#ifndef _SKINNED_MESH_BATCH_H_
+#define _SKINNED_MESH_BATCH_H_
+#include <libheaders.h>
+#include <glerror.h>
+#include <UniformBufferRing.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+//Draws many instances of one skinned mesh, skinned in the vertex shader (shader variant SKINNING).
+//The joint palettes of all instances are streamed through a UniformBufferRing into the block
+//	layout (std140) uniform SkinData { mat4 palette[SKIN_PALETTE_SIZE]; };
+//One instanced draw takes as many instances as fit into that array, gl_InstanceID * JOINT_COUNT is the first
+//matrix of an instance. The model matrix goes into the palette (Skeleton::computePalette), there is no per
+//instance vertex data and no per vertex work on the CPU.
+//
+//Per frame: clear, addInstance and fill for every character, draw.
+class SkinnedMeshBatch
+{
+public:
+	//binding: uniform block binding of "SkinData". palettesize: SKIN_PALETTE_SIZE of the shader,
+	//16 KB (256 matrices) is the smallest GL_MAX_UNIFORM_BLOCK_SIZE allowed
+	SkinnedMeshBatch(GLuint binding, uint32_t jointcount, uint32_t palettesize = 256, size_t maxinstances = 4096);
+	SkinnedMeshBatch(const SkinnedMeshBatch& other) = delete;
+	SkinnedMeshBatch& operator=(const SkinnedMeshBatch& other) = delete;
+
+	void clear();
+	//jointcount matrices for the next instance, valid until the next addInstance or clear
+	glm::mat4* addInstance();
+	//uploads the palettes and draws all instances with the bound shader. vao holds the mesh with its VertexSkin
+	//attributes, the index arguments are those of glDrawElements. Leaves vertex array 0 bound.
+	void draw(GLuint vao, GLenum mode, GLsizei indexcount, GLenum indextype, const void* indices = nullptr);
+
+	size_t getInstanceCount() const
+	{
+		return m_palettes.size() / m_jointCount;
+	}
+	//draw calls of the last draw
+	size_t getDrawCalls() const
+	{
+		return m_drawCalls;
+	}
+
+private:
+	GLuint m_binding;
+	uint32_t m_jointCount;
+	uint32_t m_paletteSize;
+	uint32_t m_instancesPerDraw;
+	size_t m_maxInstances;
+	std::vector<glm::mat4> m_palettes;
+	std::unique_ptr<UniformBufferRing> m_ring;
+	std::vector<UniformBufferRing::Allocation> m_allocations;
+	size_t m_drawCalls;
+};
+
+#endif
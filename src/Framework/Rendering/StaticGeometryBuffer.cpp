@@ -0,0 +1,215 @@
+#include "StaticGeometryBuffer.h"
+#include <GLStateCache.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+
+StaticGeometryBuffer::StaticGeometryBuffer(const std::vector<VertexAttribute>& atts, GLuint instancelocation) :
+	m_atts(atts),
+	m_stride(atts.empty() ? 0 : atts[0].stride),
+	m_instanceLocation(instancelocation),
+	m_vao(0),
+	m_vbo(0),
+	m_ibo(0),
+	m_indirect(0),
+	m_indirectCapacity(0),
+	m_indexType(GL_UNSIGNED_SHORT),
+	m_dirty(false)
+{
+	if (atts.empty())
+		throw std::logic_error("Static geometry needs at least one vertex attribute.");
+	glGenBuffers(1, &m_vbo); GLERR
+	glGenBuffers(1, &m_ibo); GLERR
+	glGenBuffers(1, &m_indirect); GLERR
+	glGenVertexArrays(1, &m_vao); GLERR
+
+	GLStateCache::bindVertexArray(m_vao);
+	GLStateCache::bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	for (size_t i = 0; i < m_atts.size(); i++)
+	{
+		const VertexAttribute& att = m_atts[i];
+		GLuint location = static_cast<GLuint>(i);
+		glEnableVertexAttribArray(location); GLERR
+		glVertexAttribPointer(location, att.n, att.type, att.normalized, att.stride, reinterpret_cast<const void*>(att.offset)); GLERR
+	}
+	GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+	m_instances.attach(m_vao, m_instanceLocation);
+}
+
+StaticGeometryBuffer::~StaticGeometryBuffer()
+{
+	GLStateCache::deleteVertexArray(m_vao);
+	GLStateCache::deleteBuffer(m_vbo);
+	GLStateCache::deleteBuffer(m_ibo);
+	GLStateCache::deleteBuffer(m_indirect);
+}
+
+size_t StaticGeometryBuffer::addMesh(const void * vertices, size_t vertexcount, const Index * indices, size_t indexcount)
+{
+	Mesh mesh;
+	mesh.firstIndex = static_cast<GLuint>(m_indexData.size());
+	mesh.indexCount = static_cast<GLuint>(indexcount);
+	mesh.baseVertex = static_cast<GLint>(m_vertexData.size() / m_stride);
+	mesh.vertexCount = static_cast<GLuint>(vertexcount);
+	mesh.meshMatrix = glm::mat4(1.0f);
+	for (size_t i = 0; i < indexcount; i++)
+	{
+		if (indices[i] >= vertexcount)
+			throw std::logic_error("Mesh index out of range.");
+	}
+
+	const char* data = static_cast<const char*>(vertices);
+	m_vertexData.insert(m_vertexData.end(), data, data + vertexcount * m_stride);
+	m_indexData.insert(m_indexData.end(), indices, indices + indexcount);
+	m_meshes.push_back(mesh);
+	m_dirty = true;
+	return m_meshes.size() - 1;
+}
+
+size_t StaticGeometryBuffer::addMesh(const OBJMesh & mesh)
+{
+	try
+	{
+		if (mesh.atts.size() != m_atts.size())
+			throw std::logic_error("Mesh vertex layout does not match the static geometry buffer.");
+		for (size_t i = 0; i < m_atts.size(); i++)
+		{
+			const VertexAttribute& a = mesh.atts[i];
+			const VertexAttribute& b = m_atts[i];
+			if (a.n != b.n || a.type != b.type || a.stride != b.stride || a.offset != b.offset || a.normalized != b.normalized)
+				throw std::logic_error("Mesh vertex layout does not match the static geometry buffer.");
+		}
+
+		size_t id;
+		if (mesh.packed)
+		{
+			id = addMesh(mesh.packedVertices.data(), mesh.packedVertices.size(), mesh.indices.data(), mesh.indices.size());
+			//the normalized unorm16 position arrives in [0, 1], offset and scale map it onto the bounding box
+			m_meshes[id].meshMatrix = glm::scale(glm::translate(glm::mat4(1.0f), mesh.positionOffset), mesh.positionScale);
+		}
+		else
+		{
+			id = addMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+		}
+		return id;
+	}
+	catch (const std::exception& ex)
+	{
+		throw ex;
+	}
+}
+
+void StaticGeometryBuffer::clearDraws()
+{
+	m_drawMeshes.clear();
+	m_drawTransforms.clear();
+}
+
+void StaticGeometryBuffer::addDraw(size_t mesh, const glm::mat4 & transform)
+{
+	if (mesh >= m_meshes.size())
+		throw std::logic_error("Invalid static mesh id.");
+	m_drawMeshes.push_back(static_cast<uint32_t>(mesh));
+	m_drawTransforms.push_back(transform);
+}
+
+bool StaticGeometryBuffer::hasMultiDrawIndirect()
+{
+	return GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+}
+
+bool StaticGeometryBuffer::hasBaseInstance()
+{
+	return GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+}
+
+void StaticGeometryBuffer::upload()
+{
+	//indices are relative to the mesh (baseVertex), so 16 bit suffice as long as every single mesh is small
+	GLuint maxvertices = 0;
+	for (const auto& mesh : m_meshes)
+		maxvertices = std::max(maxvertices, mesh.vertexCount);
+	m_indexType = OBJLoader::selectIndexType(maxvertices);
+
+	GLStateCache::bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBufferData(GL_ARRAY_BUFFER, m_vertexData.size(), m_vertexData.data(), GL_STATIC_DRAW); GLERR
+
+	//the element binding belongs to the vertex array, the copy target avoids binding it
+	GLStateCache::bindBuffer(GL_COPY_WRITE_BUFFER, m_ibo);
+	if (m_indexType == GL_UNSIGNED_SHORT)
+	{
+		std::vector<GLushort> narrow(m_indexData.begin(), m_indexData.end());
+		glBufferData(GL_COPY_WRITE_BUFFER, narrow.size() * sizeof(GLushort), narrow.data(), GL_STATIC_DRAW); GLERR
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, m_indexData.size() * sizeof(Index), m_indexData.data(), GL_STATIC_DRAW); GLERR
+	}
+	m_dirty = false;
+}
+
+void StaticGeometryBuffer::draw(GLenum mode)
+{
+	if (m_dirty)
+		upload();
+
+	//one command per mesh, the objects of a mesh become consecutive instances
+	m_meshInstances.assign(m_meshes.size(), 0);
+	for (auto mesh : m_drawMeshes)
+		m_meshInstances[mesh]++;
+	m_commands.clear();
+	GLuint first = 0;
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		GLuint count = m_meshInstances[i];
+		if (count == 0)
+			continue;
+		const Mesh& mesh = m_meshes[i];
+		m_commands.push_back(DrawElementsIndirectCommand{ mesh.indexCount, count, mesh.firstIndex, mesh.baseVertex, first });
+		m_meshInstances[i] = first;
+		first += count;
+	}
+	if (m_commands.empty())
+		return;
+	m_instanceTransforms.resize(m_drawTransforms.size());
+	for (size_t i = 0; i < m_drawMeshes.size(); i++)
+	{
+		uint32_t mesh = m_drawMeshes[i];
+		m_instanceTransforms[m_meshInstances[mesh]++] = m_drawTransforms[i] * m_meshes[mesh].meshMatrix;
+	}
+	m_instances.update(m_instanceTransforms.data(), m_instanceTransforms.size());
+
+	GLStateCache::bindVertexArray(m_vao);
+	GLsizei commandcount = static_cast<GLsizei>(m_commands.size());
+	if (hasBaseInstance())
+	{
+		GLStateCache::bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirect);
+		if (m_commands.size() > m_indirectCapacity)
+			m_indirectCapacity = m_commands.size() + m_commands.size() / 2;
+		//orphan, like the instance data
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, m_indirectCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW); GLERR
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data()); GLERR
+
+		if (hasMultiDrawIndirect())
+		{
+			glMultiDrawElementsIndirect(mode, m_indexType, nullptr, commandcount, 0); GLERR
+		}
+		else
+		{
+			for (GLsizei i = 0; i < commandcount; i++)
+			{
+				glDrawElementsIndirect(mode, m_indexType, reinterpret_cast<const void*>(i * sizeof(DrawElementsIndirectCommand))); GLERR
+			}
+		}
+	}
+	else
+	{
+		size_t indexsize = OBJLoader::getIndexSize(m_indexType);
+		for (const auto& command : m_commands)
+		{
+			m_instances.setFirstInstance(command.baseInstance, m_instanceLocation);
+			glDrawElementsInstancedBaseVertex(mode, command.count, m_indexType, reinterpret_cast<const void*>(command.firstIndex * indexsize), command.instanceCount, command.baseVertex); GLERR
+		}
+		m_instances.setFirstInstance(0, m_instanceLocation);
+	}
+	GLStateCache::bindVertexArray(0);
+}
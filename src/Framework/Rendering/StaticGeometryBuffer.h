@@ -0,0 +1,102 @@
+#ifndef _STATIC_GEOMETRY_BUFFER_H_
+#define _STATIC_GEOMETRY_BUFFER_H_
+#include <libheaders.h>
+#include <glerror.h>
+#include <CommonTypes.h>
+#include <OBJLoader.h>
+#include <InstanceBuffer.h>
+#include <vector>
+#include <cstdint>
+
+//layout of one command in the GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+//All static meshes in one vertex and one index buffer behind one vertex array.
+//Each frame the visible objects are added with addDraw(), draw() groups them by mesh into one indirect
+//command per mesh (the object transforms become instance data) and issues all commands with
+//glMultiDrawElementsIndirect. The commands live in a GL buffer, so they can later be written on the GPU.
+//
+//Without GL 4.3 / ARB_multi_draw_indirect the commands are drawn one by one with glDrawElementsIndirect,
+//without GL 4.2 / ARB_base_instance with glDrawElementsInstancedBaseVertex.
+//The shader reads the transform from "layout (location = instancelocation) in mat4".
+class StaticGeometryBuffer
+{
+public:
+	//atts: vertex layout shared by all meshes, attribute i goes to location i
+	StaticGeometryBuffer(const std::vector<VertexAttribute>& atts, GLuint instancelocation = InstanceBuffer::DEFAULT_LOCATION);
+	~StaticGeometryBuffer();
+	StaticGeometryBuffer(const StaticGeometryBuffer& other) = delete;
+	StaticGeometryBuffer& operator=(const StaticGeometryBuffer& other) = delete;
+
+	//vertices in the layout given to the constructor, indices relative to the mesh. Returns the mesh id.
+	size_t addMesh(const void* vertices, size_t vertexcount, const Index* indices, size_t indexcount);
+	//mesh.atts must match the layout. The dequantization of packed meshes is applied through the transform.
+	size_t addMesh(const OBJMesh& mesh);
+
+	//draw list of the current frame
+	void clearDraws();
+	void addDraw(size_t mesh, const glm::mat4& transform);
+	//uploads new meshes, builds the commands and draws everything added since clearDraws()
+	void draw(GLenum mode = GL_TRIANGLES);
+
+	//commands issued by the last draw (one per mesh with at least one object)
+	size_t getCommandCount() const
+	{
+		return m_commands.size();
+	}
+	size_t getMeshCount() const
+	{
+		return m_meshes.size();
+	}
+	GLuint getVertexArray() const
+	{
+		return m_vao;
+	}
+	static bool hasMultiDrawIndirect();
+	static bool hasBaseInstance();
+
+private:
+	class Mesh
+	{
+	public:
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+		GLuint vertexCount;
+		glm::mat4 meshMatrix;	//applied before the object transform
+	};
+
+	std::vector<VertexAttribute> m_atts;
+	GLsizei m_stride;
+	GLuint m_instanceLocation;
+	GLuint m_vao;
+	GLuint m_vbo;
+	GLuint m_ibo;
+	GLuint m_indirect;
+	size_t m_indirectCapacity;	//commands
+	InstanceBuffer m_instances;
+	GLenum m_indexType;
+
+	//CPU copies, kept so that meshes added later can be uploaded together with the old ones
+	std::vector<char> m_vertexData;
+	std::vector<Index> m_indexData;
+	std::vector<Mesh> m_meshes;
+	bool m_dirty;
+
+	std::vector<uint32_t> m_drawMeshes;
+	std::vector<glm::mat4> m_drawTransforms;
+	std::vector<glm::mat4> m_instanceTransforms;	//draw transforms grouped by mesh
+	std::vector<uint32_t> m_meshInstances;
+	std::vector<DrawElementsIndirectCommand> m_commands;
+
+	void upload();
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "StreamBuffer.h"
+#include <GLStateCache.h>
+
+StreamBuffer::StreamBuffer(GLsizeiptr capacity, GLsizeiptr alignment, unsigned int frames) :
+	m_buffer(0),
+	m_alignment(alignment > 0 ? alignment : 1),
+	m_capacity(0),
+	m_frames(frames > 0 ? frames : 1),
+	m_frame(0),
+	m_head(0),
+	m_flushed(0),
+	m_mapped(nullptr),
+	m_fences(m_frames, nullptr)
+{
+	m_capacity = (capacity + m_alignment - 1) / m_alignment * m_alignment;
+	GLsizeiptr size = m_capacity * m_frames;
+
+	//the copy target changes no vertex array or indexed binding
+	glGenBuffers(1, &m_buffer); GLERR
+	GLStateCache::bindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags); GLERR
+		m_mapped = static_cast<char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags)); GLERR
+	}
+	if (!m_mapped)
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW); GLERR
+		m_staging.resize(static_cast<size_t>(m_capacity));
+	}
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for (auto& fence : m_fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+	}
+	if (m_mapped)
+	{
+		GLStateCache::bindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+	GLStateCache::deleteBuffer(m_buffer);
+}
+
+void StreamBuffer::beginFrame()
+{
+	GLsync& fence = m_fences[m_frame];
+	if (fence)
+	{
+		//flush once so the fence is guaranteed to signal, then keep waiting
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(fence, 0, 1000000);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	m_head = 0;
+	m_flushed = 0;
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	if (alignment <= 0)
+		alignment = m_alignment;
+	//align the offset in the buffer, regions need not start at a multiple of alignment
+	GLsizeiptr base = m_frame * m_capacity;
+	GLsizeiptr head = ((base + m_head + alignment - 1) / alignment) * alignment - base;
+	if (size > m_capacity - head)
+		throw std::logic_error("Stream buffer is full.");
+	Allocation allocation;
+	allocation.offset = base + head;
+	allocation.size = size;
+	allocation.data = m_mapped ? m_mapped + allocation.offset : m_staging.data() + head;
+	m_head = head + size;
+	return allocation;
+}
+
+void StreamBuffer::flush()
+{
+	if (m_mapped || m_flushed == m_head)
+		return;
+	GLStateCache::bindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, m_frame * m_capacity + m_flushed, m_head - m_flushed, m_staging.data() + m_flushed); GLERR
+	m_flushed = m_head;
+}
+
+void StreamBuffer::endFrame()
+{
+	flush();
+	m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); GLERR
+	m_frame = (m_frame + 1) % m_frames;
+}
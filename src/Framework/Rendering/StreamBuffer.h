@@ -0,0 +1,80 @@
+#ifndef _STREAM_BUFFER_H_
+#define _STREAM_BUFFER_H_
+#include <libheaders.h>
+#include <glerror.h>
+#include <vector>
+
+//Buffer for data that is rewritten every frame (dynamic vertices, debug lines, particles, per object uniforms).
+//The buffer is split into one region per frame in flight. Every frame allocates from its own region,
+//a fence per region keeps the CPU from overwriting data the GPU still reads.
+//
+//With GL 4.4 / ARB_buffer_storage the buffer is persistently and coherently mapped and allocations point into it.
+//Otherwise they point into a staging copy of the region that flush() uploads with a single glBufferSubData.
+//The buffer is not tied to a target: bind getBuffer() as vertex, index, uniform or indirect buffer as needed.
+//
+//Per frame: beginFrame, allocate and fill, flush, draw, endFrame.
+class StreamBuffer
+{
+public:
+	class Allocation
+	{
+	public:
+		char* data = nullptr;	//write only, valid until flush (staging) or endFrame (persistent)
+		GLintptr offset = 0;	//offset in the buffer
+		GLsizeiptr size = 0;
+	};
+
+	//capacity: bytes available per frame. alignment: default alignment of allocations.
+	//frames: number of frames the CPU may run ahead of the GPU
+	StreamBuffer(GLsizeiptr capacity, GLsizeiptr alignment = 16, unsigned int frames = 3);
+	~StreamBuffer();
+	StreamBuffer(const StreamBuffer& other) = delete;
+	StreamBuffer& operator=(const StreamBuffer& other) = delete;
+
+	//waits until the GPU is done with the region of this frame
+	void beginFrame();
+	//Reserves size bytes. The offset is a multiple of alignment (0: the default alignment), which need not be
+	//a power of two: vertex data aligned to its stride can be drawn with first = offset / stride.
+	//Throws std::logic_error if the region of the frame is full.
+	Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 0);
+	//uploads everything allocated since the last flush (staging only). Call before the draws that use it.
+	void flush();
+	//fences the region of this frame
+	void endFrame();
+
+	GLuint getBuffer() const
+	{
+		return m_buffer;
+	}
+	GLsizeiptr getAlignment() const
+	{
+		return m_alignment;
+	}
+	GLsizeiptr getCapacity() const
+	{
+		return m_capacity;
+	}
+	bool isPersistent() const
+	{
+		return m_mapped != nullptr;
+	}
+	//bytes allocated in the current frame
+	GLsizeiptr getUsed() const
+	{
+		return m_head;
+	}
+
+private:
+	GLuint m_buffer;
+	GLsizeiptr m_alignment;
+	GLsizeiptr m_capacity;		//per frame, multiple of m_alignment
+	unsigned int m_frames;
+	unsigned int m_frame;		//current region
+	GLsizeiptr m_head;			//allocated bytes in the current region
+	GLsizeiptr m_flushed;		//uploaded bytes in the current region (staging)
+	char* m_mapped;				//persistent mapping of the whole buffer, or nullptr
+	std::vector<char> m_staging;
+	std::vector<GLsync> m_fences;
+};
+
+#endif
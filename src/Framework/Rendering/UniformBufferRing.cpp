@@ -0,0 +1,18 @@
+#include "UniformBufferRing.h"
+#include <GLStateCache.h>
+
+UniformBufferRing::UniformBufferRing(GLsizeiptr capacity, unsigned int frames) :
+	StreamBuffer(capacity, queryAlignment(), frames)
+{}
+
+GLsizeiptr UniformBufferRing::queryAlignment()
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment); GLERR
+	return alignment > 0 ? alignment : 256;
+}
+
+void UniformBufferRing::bind(GLuint binding, const Allocation & allocation)
+{
+	GLStateCache::bindBufferRange(GL_UNIFORM_BUFFER, binding, getBuffer(), allocation.offset, allocation.size);
+}
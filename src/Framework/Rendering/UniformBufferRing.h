@@ -0,0 +1,30 @@
+#ifndef _UNIFORM_BUFFER_RING_H_
+#define _UNIFORM_BUFFER_RING_H_
+#include <libheaders.h>
+#include <glerror.h>
+#include <StreamBuffer.h>
+
+//Stream buffer for uniform blocks that change every frame (i.e. per object blocks).
+//Allocations are aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT and bound with glBindBufferRange,
+//so hundreds of objects need no glUniform* calls.
+//
+//Per frame: beginFrame, allocate and fill all blocks, flush, draw with bind, endFrame.
+class UniformBufferRing : public StreamBuffer
+{
+public:
+	//capacity: bytes available per frame. frames: number of frames the CPU may run ahead of the GPU
+	UniformBufferRing(GLsizeiptr capacity, unsigned int frames = 3);
+
+	//binds allocation to a uniform buffer binding point
+	void bind(GLuint binding, const Allocation& allocation);
+
+	//GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT of the current context
+	static GLsizeiptr queryAlignment();
+	//bytes a block of blocksize takes in a ring aligned to alignment
+	static GLsizeiptr alignedSize(GLsizeiptr blocksize, GLsizeiptr alignment)
+	{
+		return (blocksize + alignment - 1) / alignment * alignment;
+	}
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include "SceneGraph.h"
+
+const SceneGraph::NodeId SceneGraph::INVALID_NODE;
+const uint32_t SceneGraph::NONE;
+
+SceneGraph::SceneGraph() :
+	m_orderValid(true),
+	m_updated(0)
+{}
+
+uint32_t SceneGraph::indexOf(NodeId node) const
+{
+	if (node >= m_indexOf.size() || m_indexOf[node] == NONE)
+		throw std::logic_error("Invalid scene graph node.");
+	return m_indexOf[node];
+}
+
+bool SceneGraph::isValid(NodeId node) const
+{
+	return node < m_indexOf.size() && m_indexOf[node] != NONE;
+}
+
+SceneGraph::NodeId SceneGraph::createNode(NodeId parent, const glm::mat4 & local)
+{
+	uint32_t parentindex = parent == INVALID_NODE ? NONE : indexOf(parent);
+	NodeId id;
+	if (!m_freeIds.empty())
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<NodeId>(m_indexOf.size());
+		m_indexOf.push_back(NONE);
+	}
+	uint32_t index = static_cast<uint32_t>(m_local.size());
+	m_indexOf[id] = index;
+	m_ids.push_back(id);
+	m_parent.push_back(parentindex);
+	m_subtreeEnd.push_back(index + 1);
+	m_local.push_back(local);
+	m_world.push_back(local);
+	m_dirty.push_back(1);
+	m_dirtyBelow.push_back(0);
+	m_changed.push_back(0);
+
+	//appending stays depth first if the parent's subtree ends at the back (i.e. building a hierarchy top down)
+	if (parentindex != NONE && m_orderValid)
+	{
+		if (m_subtreeEnd[parentindex] == index)
+		{
+			for (uint32_t a = parentindex; a != NONE && m_subtreeEnd[a] == index; a = m_parent[a])
+				m_subtreeEnd[a] = index + 1;
+		}
+		else
+		{
+			m_orderValid = false;
+		}
+	}
+	for (uint32_t a = parentindex; a != NONE && !m_dirtyBelow[a]; a = m_parent[a])
+		m_dirtyBelow[a] = 1;
+	return id;
+}
+
+void SceneGraph::removeNode(NodeId node)
+{
+	if (!m_orderValid)
+		rebuildOrder();
+	uint32_t index = indexOf(node);
+	//dead entries are dropped by the next rebuild
+	for (uint32_t i = index; i < m_subtreeEnd[index]; i++)
+	{
+		m_indexOf[m_ids[i]] = NONE;
+		m_freeIds.push_back(m_ids[i]);
+		m_ids[i] = INVALID_NODE;
+	}
+	m_orderValid = false;
+}
+
+void SceneGraph::setParent(NodeId node, NodeId parent)
+{
+	if (!m_orderValid)
+		rebuildOrder();
+	uint32_t index = indexOf(node);
+	uint32_t parentindex = parent == INVALID_NODE ? NONE : indexOf(parent);
+	if (parentindex != NONE && parentindex >= index && parentindex < m_subtreeEnd[index])
+		throw std::logic_error("A scene graph node can't become a child of its own subtree.");
+	m_parent[index] = parentindex;
+	m_dirty[index] = 1;
+	m_orderValid = false;
+}
+
+SceneGraph::NodeId SceneGraph::getParent(NodeId node) const
+{
+	uint32_t parentindex = m_parent[indexOf(node)];
+	return parentindex == NONE ? INVALID_NODE : m_ids[parentindex];
+}
+
+void SceneGraph::setLocalMatrix(NodeId node, const glm::mat4 & local)
+{
+	uint32_t index = indexOf(node);
+	m_local[index] = local;
+	m_dirty[index] = 1;
+	//stops at the first ancestor that is marked already, its own ancestors are marked too
+	for (uint32_t a = m_parent[index]; a != NONE && !m_dirtyBelow[a]; a = m_parent[a])
+		m_dirtyBelow[a] = 1;
+}
+
+const glm::mat4 & SceneGraph::getLocalMatrix(NodeId node) const
+{
+	return m_local[indexOf(node)];
+}
+
+const glm::mat4 & SceneGraph::getWorldMatrix(NodeId node) const
+{
+	return m_world[indexOf(node)];
+}
+
+void SceneGraph::update()
+{
+	if (!m_orderValid)
+		rebuildOrder();
+	m_updated = 0;
+	uint32_t count = static_cast<uint32_t>(m_local.size());
+	for (uint32_t i = 0; i < count;)
+	{
+		//parents come first, m_changed of the parent is already up to date
+		uint32_t parent = m_parent[i];
+		if (m_dirty[i] || (parent != NONE && m_changed[parent]))
+		{
+			m_world[i] = parent == NONE ? m_local[i] : m_world[parent] * m_local[i];
+			m_changed[i] = 1;
+			m_dirty[i] = 0;
+			m_dirtyBelow[i] = 0;
+			m_updated++;
+			i++;
+		}
+		else if (m_dirtyBelow[i])
+		{
+			m_changed[i] = 0;
+			m_dirtyBelow[i] = 0;
+			i++;
+		}
+		else
+		{
+			//nothing changed in this subtree. Its m_changed flags are stale but only read by its own nodes.
+			i = m_subtreeEnd[i];
+		}
+	}
+}
+
+void SceneGraph::rebuildOrder()
+{
+	uint32_t count = static_cast<uint32_t>(m_local.size());
+
+	//children of every node in the current order (compressed rows), roots in the extra row "count"
+	std::vector<uint32_t> childstart(count + 2, 0);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (m_ids[i] != INVALID_NODE)
+			childstart[(m_parent[i] == NONE ? count : m_parent[i]) + 1]++;
+	}
+	for (uint32_t i = 0; i <= count; i++)
+		childstart[i + 1] += childstart[i];
+	std::vector<uint32_t> children(childstart[count + 1]);
+	std::vector<uint32_t> fill(childstart.begin(), childstart.end() - 1);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (m_ids[i] != INVALID_NODE)
+			children[fill[m_parent[i] == NONE ? count : m_parent[i]]++] = i;
+	}
+
+	//depth first, siblings keep their relative order
+	std::vector<uint32_t> order;
+	order.reserve(children.size());
+	std::vector<uint32_t> stack;
+	for (uint32_t r = childstart[count + 1]; r > childstart[count]; r--)
+		stack.push_back(children[r - 1]);
+	while (!stack.empty())
+	{
+		uint32_t i = stack.back();
+		stack.pop_back();
+		order.push_back(i);
+		for (uint32_t c = childstart[i + 1]; c > childstart[i]; c--)
+			stack.push_back(children[c - 1]);
+	}
+
+	std::vector<uint32_t> newindex(count, NONE);
+	for (uint32_t k = 0; k < order.size(); k++)
+		newindex[order[k]] = k;
+
+	uint32_t alive = static_cast<uint32_t>(order.size());
+	std::vector<NodeId> ids(alive);
+	std::vector<uint32_t> parents(alive);
+	std::vector<glm::mat4> locals(alive);
+	std::vector<glm::mat4> worlds(alive);
+	for (uint32_t k = 0; k < alive; k++)
+	{
+		uint32_t i = order[k];
+		ids[k] = m_ids[i];
+		parents[k] = m_parent[i] == NONE ? NONE : newindex[m_parent[i]];
+		locals[k] = m_local[i];
+		worlds[k] = m_world[i];
+		m_indexOf[ids[k]] = k;
+	}
+	//subtree sizes from the back: children come after their parent
+	std::vector<uint32_t> subtreeend(alive);
+	std::vector<uint32_t> size(alive, 1);
+	for (uint32_t k = alive; k > 0; k--)
+	{
+		uint32_t i = k - 1;
+		subtreeend[i] = i + size[i];
+		if (parents[i] != NONE)
+			size[parents[i]] += size[i];
+	}
+
+	m_ids.swap(ids);
+	m_parent.swap(parents);
+	m_subtreeEnd.swap(subtreeend);
+	m_local.swap(locals);
+	m_world.swap(worlds);
+	//structure changed: recompute everything once
+	m_dirty.assign(alive, 1);
+	m_dirtyBelow.assign(alive, 0);
+	m_changed.assign(alive, 0);
+	m_orderValid = true;
+}
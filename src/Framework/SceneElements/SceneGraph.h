@@ -0,0 +1,78 @@
+#ifndef _SCENE_GRAPH_H_
+#define _SCENE_GRAPH_H_
+#include <libheaders.h>
+#include "Transform.h"
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+//Parent/child hierarchy of local matrices with cached world matrices.
+//Nodes live in flat arrays in depth first order, so every subtree is one contiguous range and parents come
+//before their children. setLocalMatrix flags the node and marks its ancestors, update() then walks the arrays
+//once, recomputes only flagged nodes and their descendants and jumps over clean subtrees as a whole:
+//static parts of the scene cost nothing per frame.
+//Node ids stay valid until the node is removed, the array order is rebuilt after structural changes.
+class SceneGraph
+{
+public:
+	typedef uint32_t NodeId;
+	static const NodeId INVALID_NODE = 0xFFFFFFFFu;
+
+	SceneGraph();
+
+	//parent: INVALID_NODE for a root
+	NodeId createNode(NodeId parent = INVALID_NODE, const glm::mat4& local = glm::mat4(1.0f));
+	//removes node and all its descendants
+	void removeNode(NodeId node);
+	//moves node with its subtree under parent (INVALID_NODE: make it a root)
+	void setParent(NodeId node, NodeId parent);
+	NodeId getParent(NodeId node) const;
+	bool isValid(NodeId node) const;
+
+	void setLocalMatrix(NodeId node, const glm::mat4& local);
+	void setLocalTransform(NodeId node, Transform& local)
+	{
+		setLocalMatrix(node, local.getMatrix());
+	}
+	const glm::mat4& getLocalMatrix(NodeId node) const;
+	//world matrix as of the last update()
+	const glm::mat4& getWorldMatrix(NodeId node) const;
+
+	//recomputes the world matrices of all changed nodes and their subtrees
+	void update();
+
+	size_t getNodeCount() const
+	{
+		return m_local.size();
+	}
+	//world matrices recomputed by the last update
+	size_t getUpdatedCount() const
+	{
+		return m_updated;
+	}
+
+private:
+	static const uint32_t NONE = 0xFFFFFFFFu;
+
+	//per array index, depth first order
+	std::vector<NodeId> m_ids;
+	std::vector<uint32_t> m_parent;			//index of the parent or NONE
+	std::vector<uint32_t> m_subtreeEnd;		//one past the last descendant
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+	std::vector<uint8_t> m_dirty;			//local matrix changed
+	std::vector<uint8_t> m_dirtyBelow;		//some descendant is dirty
+	std::vector<uint8_t> m_changed;			//world matrix recomputed in this update
+
+	//per node id
+	std::vector<uint32_t> m_indexOf;		//NONE for free ids
+	std::vector<NodeId> m_freeIds;
+
+	bool m_orderValid;
+	size_t m_updated;
+
+	uint32_t indexOf(NodeId node) const;
+	void rebuildOrder();
+};
+
+#endif
@@ -5,10 +5,33 @@
 void Transform::updateTransformMatrix()
 {
 	m_transformMatrix = glm::translate(m_position) * glm::toMat4(m_rotation) * glm::scale(m_scale);
+	m_matrixDirty = false;
+	m_axesDirty = true;
+}
+
+void Transform::updateTRS()
+{
+	glm::vec3 x(m_transformMatrix[0]);
+	glm::vec3 y(m_transformMatrix[1]);
+	glm::vec3 z(m_transformMatrix[2]);
+	m_position = glm::vec3(m_transformMatrix[3]);
+	m_scale = glm::vec3(glm::length(x), glm::length(y), glm::length(z));
+	//rotation from the unscaled axes, quat_cast expects an orthonormal matrix
+	if (m_scale.x > 0.0f) x /= m_scale.x;
+	if (m_scale.y > 0.0f) y /= m_scale.y;
+	if (m_scale.z > 0.0f) z /= m_scale.z;
+	m_rotation = glm::quat_cast(glm::mat3(x, y, z));
+	m_trsDirty = false;
+}
 
+void Transform::updateAxes()
+{
+	if (m_matrixDirty)
+		updateTransformMatrix();
 	m_xaxis = glm::normalize(glm::vec3(m_transformMatrix[0]));
 	m_yaxis = glm::normalize(glm::vec3(m_transformMatrix[1]));
 	m_zaxis = glm::normalize(glm::vec3(m_transformMatrix[2]));
+	m_axesDirty = false;
 }
 
 Transform::Transform() :
@@ -18,19 +41,20 @@ Transform::Transform() :
 	m_transformMatrix(),
 	m_xaxis(1.0f, 0.0f, 0.0f),
 	m_yaxis(0.0f, 1.0f, 0.0f),
-	m_zaxis(0.0f, 1.0f, 0.0f),
-	m_matrixDirty(true)
+	m_zaxis(0.0f, 0.0f, 1.0f),
+	m_matrixDirty(true),
+	m_trsDirty(false),
+	m_axesDirty(true)
 {}
 
 Transform::Transform(const glm::mat4 & transformMatrix) :
 	m_position(transformMatrix[3]),
-	m_rotation(glm::quat_cast(transformMatrix)),
-	m_scale(glm::length(glm::vec3(transformMatrix[0])), glm::length(glm::vec3(transformMatrix[1])), glm::length(glm::vec3(transformMatrix[2]))),
+	m_rotation(1.0f, 0.0f, 0.0f, 0.0f),
+	m_scale(1.0f),
 	m_transformMatrix(transformMatrix),
-	m_xaxis(glm::normalize(glm::vec3(transformMatrix[0]))),
-	m_yaxis(glm::normalize(glm::vec3(transformMatrix[1]))),
-	m_zaxis(glm::normalize(glm::vec3(transformMatrix[2]))),
-	m_matrixDirty(true)
+	m_matrixDirty(false),
+	m_trsDirty(true),
+	m_axesDirty(true)
 {
 }
 
@@ -38,42 +62,57 @@ Transform::Transform(const glm::vec3 & position, const glm::quat & rotation, con
 	m_position(position),
 	m_rotation(rotation),
 	m_scale(scale),
-	m_transformMatrix(glm::translate(position) * glm::toMat4(rotation) * glm::scale(scale)),
-	m_xaxis(glm::normalize(glm::vec3(toMat3(rotation)[0]))),
-	m_yaxis(glm::normalize(glm::vec3(toMat3(rotation)[1]))),
-	m_zaxis(glm::normalize(glm::vec3(toMat3(rotation)[2]))),
-	m_matrixDirty(true)
+	m_transformMatrix(),
+	m_matrixDirty(true),
+	m_trsDirty(false),
+	m_axesDirty(true)
 {}
 
 const glm::vec3 & Transform::getPosition()
 {
+	if (m_trsDirty)
+		updateTRS();
 	return m_position;
 }
 
 const glm::quat & Transform::getRotation()
 {
+	if (m_trsDirty)
+		updateTRS();
 	return m_rotation;
 }
 
 const glm::vec3 & Transform::getScale()
 {
+	if (m_trsDirty)
+		updateTRS();
 	return m_scale;
 }
 
 void Transform::setPosition(const glm::vec3 & position)
 {
+	if (m_trsDirty)
+	{
+		//only the translation column changes, no need to decompose
+		m_transformMatrix[3] = glm::vec4(position, 1.0f);
+		return;
+	}
 	m_position = position;
 	m_matrixDirty = true;
 }
 
 void Transform::setRotation(const glm::quat & rotation)
 {
+	if (m_trsDirty)
+		updateTRS();
 	m_rotation = rotation;
 	m_matrixDirty = true;
 }
 
 void Transform::setScale(const glm::vec3 & scale)
 {
+	if (m_trsDirty)
+		updateTRS();
 	m_scale = scale;
 	m_matrixDirty = true;
 }
@@ -81,93 +120,97 @@ void Transform::setScale(const glm::vec3 & scale)
 const glm::mat4 & Transform::getMatrix()
 {
 	if (m_matrixDirty)
-	{
 		updateTransformMatrix();
-		m_matrixDirty = false;
-	}
 	return m_transformMatrix;
 }
 
 void Transform::setMatrix(const glm::mat4 & matrix)
 {
-	Transform tmp(matrix);
-	m_position = tmp.m_position;
-	m_rotation = tmp.m_rotation;
-	m_scale = tmp.m_scale;
 	m_transformMatrix = matrix;
-	m_xaxis = tmp.m_xaxis;
-	m_yaxis = tmp.m_yaxis;
-	m_zaxis = tmp.m_zaxis;
 	m_matrixDirty = false;
+	m_trsDirty = true;
+	m_axesDirty = true;
 }
 
 void Transform::translate(const glm::vec3 & deltaPos)
 {
+	if (m_trsDirty)
+	{
+		m_transformMatrix[3] += glm::vec4(deltaPos, 0.0f);
+		return;
+	}
 	m_position += deltaPos;
 	m_matrixDirty = true;
 }
 
 void Transform::translateLocal(const glm::vec3 & deltaPos)
 {
-	m_position += deltaPos.x * m_xaxis + deltaPos.y * m_yaxis + deltaPos.z * m_zaxis;
-	m_matrixDirty = true;
+	translate(deltaPos.x * getXAxis() + deltaPos.y * getYAxis() + deltaPos.z * getZAxis());
 }
 
 void Transform::rotate(const glm::quat & deltaRot)
 {
+	if (m_trsDirty)
+	{
+		//rotating in world space only touches the upper 3x3 and the translation
+		glm::mat3 r = glm::toMat3(glm::normalize(deltaRot));
+		m_transformMatrix[0] = glm::vec4(r * glm::vec3(m_transformMatrix[0]), 0.0f);
+		m_transformMatrix[1] = glm::vec4(r * glm::vec3(m_transformMatrix[1]), 0.0f);
+		m_transformMatrix[2] = glm::vec4(r * glm::vec3(m_transformMatrix[2]), 0.0f);
+		m_axesDirty = true;
+		return;
+	}
 	m_rotation = glm::normalize(deltaRot * m_rotation);
 	m_matrixDirty = true;
 }
 
 void Transform::rotateLocal(const glm::quat & deltaRot)
 {
+	if (m_trsDirty)
+		updateTRS();
 	m_rotation = glm::normalize(m_rotation * deltaRot);
 	m_matrixDirty = true;
 }
 
 void Transform::scale(const glm::vec3 & scale)
 {
+	if (m_trsDirty)
+	{
+		//scale is applied first: scales the basis columns
+		m_transformMatrix[0] *= scale.x;
+		m_transformMatrix[1] *= scale.y;
+		m_transformMatrix[2] *= scale.z;
+		return;
+	}
 	m_scale *= scale;
 	m_matrixDirty = true;
 }
 
 const glm::vec3 & Transform::getXAxis()
 {
-	if (m_matrixDirty)
-	{
-		updateTransformMatrix();
-		m_matrixDirty = false;
-	}
+	if (m_matrixDirty || m_axesDirty)
+		updateAxes();
 	return m_xaxis;
 }
 
 const glm::vec3 & Transform::getYAxis()
 {
-	if (m_matrixDirty)
-	{
-		updateTransformMatrix();
-		m_matrixDirty = false;
-	}
+	if (m_matrixDirty || m_axesDirty)
+		updateAxes();
 	return m_yaxis;
 }
 
 const glm::vec3 & Transform::getZAxis()
 {
-	if (m_matrixDirty)
-	{
-		updateTransformMatrix();
-		m_matrixDirty = false;
-	}
+	if (m_matrixDirty || m_axesDirty)
+		updateAxes();
 	return m_zaxis;
 }
 
 const glm::mat4 & Transform::getTransformMatrix()
 {
 	if (m_matrixDirty)
-	{
 		updateTransformMatrix();
-		m_matrixDirty = false;
-	}
 	return m_transformMatrix;
 }
 
@@ -191,10 +234,7 @@ void Transform::lookinto(const glm::vec3 & direction)
 glm::mat4 Transform::getInverseMatrix()
 {
 	if (m_matrixDirty)
-	{
 		updateTransformMatrix();
-		m_matrixDirty = false;
-	}
 	return glm::inverse(m_transformMatrix);
 }
 
@@ -204,10 +244,13 @@ Transform::~Transform()
 
 void Transform::rotateAroundPoint(const glm::vec3 point, const glm::quat &deltaRot) {
 
-    glm::mat4x4 mm = getMatrix();
-    mm = glm::translate(-point)*mm;
-    mm = glm::toMat4(deltaRot)*mm;
-    mm = glm::translate(point) *mm;
+    // translate(point) * rotation * translate(-point) * matrix, without the three 4x4 products
+    glm::mat3 r = glm::toMat3(deltaRot);
+    glm::mat4 mm = getMatrix();
+    mm[0] = glm::vec4(r * glm::vec3(mm[0]), 0.0f);
+    mm[1] = glm::vec4(r * glm::vec3(mm[1]), 0.0f);
+    mm[2] = glm::vec4(r * glm::vec3(mm[2]), 0.0f);
+    mm[3] = glm::vec4(r * (glm::vec3(mm[3]) - point) + point, 1.0f);
     setMatrix(mm);
 
     /*
@@ -6,7 +6,9 @@ class Transform
 {
 private:
 	glm::mat4 m_transformMatrix;
-	bool m_matrixDirty;
+	bool m_matrixDirty;		//position/rotation/scale changed, matrix has to be composed
+	bool m_trsDirty;		//matrix was set directly, position/rotation/scale have to be decomposed
+	bool m_axesDirty;
 
 	glm::vec3 m_position;
 	glm::quat m_rotation;
@@ -17,6 +19,8 @@ private:
 	glm::vec3 m_zaxis;
 
 	void updateTransformMatrix();
+	void updateTRS();
+	void updateAxes();
 
 public:
 	Transform();
@@ -37,6 +41,8 @@ public:
 	void setScale(const glm::vec3& scale);
 
 	const glm::mat4& getMatrix();
+	//Stores the matrix as it is. Position, rotation and scale are only decomposed from it when asked for,
+	//translate/rotate/scale/rotateAroundPoint work on the matrix directly until then.
 	void setMatrix(const glm::mat4& matrix);
 
 	void translate(const glm::vec3& deltaPos);
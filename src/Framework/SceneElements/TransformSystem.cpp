@@ -0,0 +1,239 @@
+#include "TransformSystem.h"
+#include <fw_config.h>
+#include <algorithm>
+
+#ifdef VC_SSE2
+#include <emmintrin.h>
+#endif
+
+const TransformSystem::Handle TransformSystem::INVALID_HANDLE;
+const uint32_t TransformSystem::NONE;
+
+TransformSystem::TransformSystem() :
+	m_count(0),
+	m_composed(0)
+{}
+
+uint32_t TransformSystem::indexOf(Handle handle) const
+{
+	if (handle >= m_indexOf.size() || m_indexOf[handle] == NONE)
+		throw std::logic_error("Invalid transform handle.");
+	return m_indexOf[handle];
+}
+
+bool TransformSystem::isValid(Handle handle) const
+{
+	return handle < m_indexOf.size() && m_indexOf[handle] != NONE;
+}
+
+void TransformSystem::reserve(size_t count)
+{
+	size_t padded = (count + 3) & ~size_t(3);
+	for (std::vector<float>* a : { &m_px, &m_py, &m_pz, &m_qx, &m_qy, &m_qz, &m_qw, &m_sx, &m_sy, &m_sz })
+		a->reserve(padded);
+	m_matrices.reserve(padded);
+	m_handles.reserve(padded);
+	m_dirty.reserve(padded / 4);
+}
+
+void TransformSystem::setIdentity(uint32_t index)
+{
+	m_px[index] = 0.0f; m_py[index] = 0.0f; m_pz[index] = 0.0f;
+	m_qx[index] = 0.0f; m_qy[index] = 0.0f; m_qz[index] = 0.0f; m_qw[index] = 1.0f;
+	m_sx[index] = 1.0f; m_sy[index] = 1.0f; m_sz[index] = 1.0f;
+	m_handles[index] = INVALID_HANDLE;
+}
+
+TransformSystem::Handle TransformSystem::create(const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & scale)
+{
+	//grow by a whole block, the padding lanes are composed as identity
+	if (m_count == m_matrices.size())
+	{
+		size_t padded = m_count + 4;
+		for (std::vector<float>* a : { &m_px, &m_py, &m_pz, &m_qx, &m_qy, &m_qz, &m_qw, &m_sx, &m_sy, &m_sz })
+			a->resize(padded);
+		m_matrices.resize(padded, glm::mat4(1.0f));
+		m_handles.resize(padded);
+		m_dirty.push_back(0);
+		for (size_t i = m_count; i < padded; i++)
+			setIdentity(static_cast<uint32_t>(i));
+	}
+
+	Handle handle;
+	if (!m_freeHandles.empty())
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<Handle>(m_indexOf.size());
+		m_indexOf.push_back(NONE);
+	}
+	uint32_t index = static_cast<uint32_t>(m_count++);
+	m_indexOf[handle] = index;
+	m_handles[index] = handle;
+	m_px[index] = position.x; m_py[index] = position.y; m_pz[index] = position.z;
+	m_qx[index] = rotation.x; m_qy[index] = rotation.y; m_qz[index] = rotation.z; m_qw[index] = rotation.w;
+	m_sx[index] = scale.x; m_sy[index] = scale.y; m_sz[index] = scale.z;
+	m_dirty[index >> 2] = 1;
+	return handle;
+}
+
+void TransformSystem::destroy(Handle handle)
+{
+	uint32_t index = indexOf(handle);
+	uint32_t last = static_cast<uint32_t>(m_count - 1);
+	if (index != last)
+	{
+		m_px[index] = m_px[last]; m_py[index] = m_py[last]; m_pz[index] = m_pz[last];
+		m_qx[index] = m_qx[last]; m_qy[index] = m_qy[last]; m_qz[index] = m_qz[last]; m_qw[index] = m_qw[last];
+		m_sx[index] = m_sx[last]; m_sy[index] = m_sy[last]; m_sz[index] = m_sz[last];
+		m_matrices[index] = m_matrices[last];
+		m_handles[index] = m_handles[last];
+		m_indexOf[m_handles[index]] = index;
+		m_dirty[index >> 2] = 1;
+	}
+	setIdentity(last);
+	m_matrices[last] = glm::mat4(1.0f);
+	m_indexOf[handle] = NONE;
+	m_freeHandles.push_back(handle);
+	m_count--;
+
+	//drop the last block once it is empty
+	if (m_matrices.size() - m_count == 4)
+	{
+		size_t padded = m_count;
+		for (std::vector<float>* a : { &m_px, &m_py, &m_pz, &m_qx, &m_qy, &m_qz, &m_qw, &m_sx, &m_sy, &m_sz })
+			a->resize(padded);
+		m_matrices.resize(padded);
+		m_handles.resize(padded);
+		m_dirty.pop_back();
+	}
+}
+
+void TransformSystem::setPosition(Handle handle, const glm::vec3 & position)
+{
+	uint32_t index = indexOf(handle);
+	m_px[index] = position.x; m_py[index] = position.y; m_pz[index] = position.z;
+	m_dirty[index >> 2] = 1;
+}
+
+void TransformSystem::setRotation(Handle handle, const glm::quat & rotation)
+{
+	uint32_t index = indexOf(handle);
+	m_qx[index] = rotation.x; m_qy[index] = rotation.y; m_qz[index] = rotation.z; m_qw[index] = rotation.w;
+	m_dirty[index >> 2] = 1;
+}
+
+void TransformSystem::setScale(Handle handle, const glm::vec3 & scale)
+{
+	uint32_t index = indexOf(handle);
+	m_sx[index] = scale.x; m_sy[index] = scale.y; m_sz[index] = scale.z;
+	m_dirty[index >> 2] = 1;
+}
+
+glm::vec3 TransformSystem::getPosition(Handle handle) const
+{
+	uint32_t index = indexOf(handle);
+	return glm::vec3(m_px[index], m_py[index], m_pz[index]);
+}
+
+glm::quat TransformSystem::getRotation(Handle handle) const
+{
+	uint32_t index = indexOf(handle);
+	return glm::quat(m_qw[index], m_qx[index], m_qy[index], m_qz[index]);
+}
+
+glm::vec3 TransformSystem::getScale(Handle handle) const
+{
+	uint32_t index = indexOf(handle);
+	return glm::vec3(m_sx[index], m_sy[index], m_sz[index]);
+}
+
+void TransformSystem::translate(Handle handle, const glm::vec3 & deltaPos)
+{
+	setPosition(handle, getPosition(handle) + deltaPos);
+}
+
+void TransformSystem::rotate(Handle handle, const glm::quat & deltaRot)
+{
+	setRotation(handle, glm::normalize(deltaRot * getRotation(handle)));
+}
+
+const glm::mat4 & TransformSystem::getMatrix(Handle handle) const
+{
+	return m_matrices[indexOf(handle)];
+}
+
+void TransformSystem::update()
+{
+	m_composed = 0;
+	for (uint32_t b = 0; b < m_dirty.size(); b++)
+	{
+		if (!m_dirty[b])
+			continue;
+		composeBlock(b * 4);
+		m_dirty[b] = 0;
+		m_composed += std::min<size_t>(4, m_count - b * 4);
+	}
+}
+
+//Same terms as glm::translate(p) * glm::toMat4(q) * glm::scale(s), for the objects first .. first + 3
+void TransformSystem::composeBlock(uint32_t first)
+{
+#ifdef VC_SSE2
+	__m128 qx = _mm_loadu_ps(&m_qx[first]);
+	__m128 qy = _mm_loadu_ps(&m_qy[first]);
+	__m128 qz = _mm_loadu_ps(&m_qz[first]);
+	__m128 qw = _mm_loadu_ps(&m_qw[first]);
+	__m128 sx = _mm_loadu_ps(&m_sx[first]);
+	__m128 sy = _mm_loadu_ps(&m_sy[first]);
+	__m128 sz = _mm_loadu_ps(&m_sz[first]);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+	__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+	__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+	//rows of the columns: c[column][row] for 4 objects
+	__m128 c[4][4];
+	c[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+	c[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+	c[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+	c[0][3] = _mm_setzero_ps();
+	c[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+	c[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+	c[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+	c[1][3] = _mm_setzero_ps();
+	c[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+	c[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+	c[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+	c[2][3] = _mm_setzero_ps();
+	c[3][0] = _mm_loadu_ps(&m_px[first]);
+	c[3][1] = _mm_loadu_ps(&m_py[first]);
+	c[3][2] = _mm_loadu_ps(&m_pz[first]);
+	c[3][3] = one;
+
+	//transposing the 4 rows of a column gives that column of each of the 4 objects
+	for (int col = 0; col < 4; col++)
+	{
+		_MM_TRANSPOSE4_PS(c[col][0], c[col][1], c[col][2], c[col][3]);
+		for (int k = 0; k < 4; k++)
+			_mm_storeu_ps(&m_matrices[first + k][col][0], c[col][k]);
+	}
+#else
+	for (uint32_t i = first; i < first + 4; i++)
+	{
+		float xx = m_qx[i] * m_qx[i], yy = m_qy[i] * m_qy[i], zz = m_qz[i] * m_qz[i];
+		float xy = m_qx[i] * m_qy[i], xz = m_qx[i] * m_qz[i], yz = m_qy[i] * m_qz[i];
+		float wx = m_qw[i] * m_qx[i], wy = m_qw[i] * m_qy[i], wz = m_qw[i] * m_qz[i];
+		glm::mat4& m = m_matrices[i];
+		m[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * m_sx[i], 2.0f * (xy + wz) * m_sx[i], 2.0f * (xz - wy) * m_sx[i], 0.0f);
+		m[1] = glm::vec4(2.0f * (xy - wz) * m_sy[i], (1.0f - 2.0f * (xx + zz)) * m_sy[i], 2.0f * (yz + wx) * m_sy[i], 0.0f);
+		m[2] = glm::vec4(2.0f * (xz + wy) * m_sz[i], 2.0f * (yz - wx) * m_sz[i], (1.0f - 2.0f * (xx + yy)) * m_sz[i], 0.0f);
+		m[3] = glm::vec4(m_px[i], m_py[i], m_pz[i], 1.0f);
+	}
+#endif
+}
@@ -0,0 +1,80 @@
+#ifndef _TRANSFORM_SYSTEM_H_
+#define _TRANSFORM_SYSTEM_H_
+#include <libheaders.h>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+//Position / rotation / scale of many objects, stored as separate float arrays (structure of arrays).
+//update() composes translate * rotate * scale for four objects at once with SSE and writes plain glm::mat4s
+//that can be uploaded as they are (InstanceBuffer::update, StaticGeometryBuffer::addDraw).
+//Changes mark their block of four, update() only composes marked blocks.
+//Handles stay valid until destroyed, the dense order changes when objects are destroyed.
+class TransformSystem
+{
+public:
+	typedef uint32_t Handle;
+	static const Handle INVALID_HANDLE = 0xFFFFFFFFu;
+
+	TransformSystem();
+
+	Handle create(const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+	//moves the last object into the gap
+	void destroy(Handle handle);
+	bool isValid(Handle handle) const;
+	void reserve(size_t count);
+
+	void setPosition(Handle handle, const glm::vec3& position);
+	void setRotation(Handle handle, const glm::quat& rotation);
+	void setScale(Handle handle, const glm::vec3& scale);
+	glm::vec3 getPosition(Handle handle) const;
+	glm::quat getRotation(Handle handle) const;
+	glm::vec3 getScale(Handle handle) const;
+
+	void translate(Handle handle, const glm::vec3& deltaPos);
+	void rotate(Handle handle, const glm::quat& deltaRot);
+
+	//composes the matrices of all changed objects
+	void update();
+
+	//matrix as of the last update()
+	const glm::mat4& getMatrix(Handle handle) const;
+	//all matrices in dense order, size() of them
+	const glm::mat4* getMatrices() const
+	{
+		return m_matrices.data();
+	}
+	size_t size() const
+	{
+		return m_count;
+	}
+	//matrices composed by the last update
+	size_t getComposedCount() const
+	{
+		return m_composed;
+	}
+
+private:
+	static const uint32_t NONE = 0xFFFFFFFFu;
+
+	//per index, padded to a multiple of 4 with identity transforms
+	std::vector<float> m_px, m_py, m_pz;
+	std::vector<float> m_qx, m_qy, m_qz, m_qw;
+	std::vector<float> m_sx, m_sy, m_sz;
+	std::vector<glm::mat4> m_matrices;
+	std::vector<Handle> m_handles;
+	std::vector<uint8_t> m_dirty;			//per block of 4
+
+	//per handle
+	std::vector<uint32_t> m_indexOf;		//NONE for free handles
+	std::vector<Handle> m_freeHandles;
+
+	size_t m_count;
+	size_t m_composed;
+
+	uint32_t indexOf(Handle handle) const;
+	void setIdentity(uint32_t index);
+	void composeBlock(uint32_t first);
+};
+
+#endif
@@ -12,7 +12,7 @@ static const float cubeVert[] =  {0.5, -0.5, -0.5, 1, 0, 0,
                                   -0.5, 0.5, 0.5, 1, 1, 1,
                                   -0.5, 0.5, -0.5, 0.5, 1, 0.5};
 
-static const int cubeInd[] = {1, 2, 3,
+static const GLushort cubeInd[] = {1, 2, 3,
                               7, 6, 5,
                               4, 5, 1,
                               5, 6, 2,
@@ -1,9 +1,42 @@
 #include "Scene.h"
 #include <AssetManager.h>
 #include "Cube.h"
+#include <Skinning.h>
+#include <string>
+
+namespace
+{
+	// cubes of the robot in draw order
+	enum RobotCube { BODY, HEAD, LEFT_LEG, RIGHT_LEG, LEFT_UPPER_ARM, RIGHT_UPPER_ARM, LEFT_LOWER_ARM, RIGHT_LOWER_ARM, ROBOT_CUBE_COUNT };
+	// joint every cube hangs at, its offset from the joint and its scale
+	const int cubeJoints[ROBOT_CUBE_COUNT] = { Scene::ROOT, Scene::NECK, Scene::LEFT_HIP, Scene::RIGHT_HIP,
+		Scene::LEFT_SHOULDER, Scene::RIGHT_SHOULDER, Scene::LEFT_ELBOW, Scene::RIGHT_ELBOW };
+	const glm::vec3 cubeOffsets[ROBOT_CUBE_COUNT] = {
+		glm::vec3(0.0f), glm::vec3(0.0f),
+		glm::vec3(0.0f, -1.25f, 0.0f), glm::vec3(0.0f, -1.25f, 0.0f),
+		glm::vec3(0.25f, -0.65f, 0.0f), glm::vec3(0.0f, -0.4f, 0.0f),
+		glm::vec3(0.0f), glm::vec3(0.0f) };
+	const glm::vec3 cubeScales[ROBOT_CUBE_COUNT] = {
+		glm::vec3(1.0f, 1.5f, 0.5f),	// Körper: stretch taller und thinner
+		glm::vec3(0.5f),				// make head smaller
+		glm::vec3(0.5f, 1.0f, 0.5f), glm::vec3(0.5f, 1.0f, 0.5f),		// Bein ist lang und dünn
+		glm::vec3(0.2f, 0.75f, 0.25f), glm::vec3(0.2f, 0.75f, 0.25f),	// Oberarm ist dick und kurz
+		glm::vec3(1.0f), glm::vec3(1.0f) };	// Unterarm ist gleich groß wie der Oberarm
+
+	glm::mat4 cubeMatrix(int cube)
+	{
+		return glm::translate(cubeOffsets[cube]) * glm::scale(cubeScales[cube]);
+	}
+}
 
 Scene::Scene(OpenGLWindow * window) :
-	m_window(window)
+	m_window(window),
+	m_instanced(true),
+	m_multiDraw(false),
+	m_showGrid(false),
+	m_showCrowd(false),
+	m_walking(true),
+	m_gpuSkinning(false)
 {
 	assert(window != nullptr);
 }
@@ -15,17 +48,64 @@ bool Scene::init()
 {
 	try {
 
-		//Load shader
-		m_assets.addShaderProgram("shader", AssetManager::createShaderProgram("assets/shaders/vertex.glsl", "assets/shaders/fragment.glsl"));
-		m_shader = m_assets.getShaderProgram("shader");
+		//Load shader: one source. The instanced and skinning variants are compiled in the background,
+		//update picks them up once they are linked. Only the default variant is waited for.
+		m_assets.registerShader("cube", "assets/shaders/vertex.glsl", "assets/shaders/fragment.glsl");
+		m_instancedVariant = m_assets.requestShaderVariant("cube", ShaderDefines().set("INSTANCED"));
+		m_skinnedVariant = m_assets.requestShaderVariant("cube", ShaderDefines().set("SKINNING").set("JOINT_COUNT", std::to_string(ROBOT_JOINT_COUNT)).set("SKIN_PALETTE_SIZE", "256"));
+		m_instancedShader = nullptr;
+		m_skinnedShader = nullptr;
+		m_assets.updatePendingShaderPrograms();
+		m_shader = m_assets.getShaderVariant("cube", ShaderDefines());
 		m_shader->use();
 
+		// Per object data (model matrix) comes from a uniform buffer
+		const UniformBlock* objectBlock = m_shader->getUniformBlock("ObjectData");
+		if (!objectBlock || !objectBlock->getMember("modelMatrix"))
+			throw std::logic_error("Shader has no ObjectData block with a modelMatrix.");
+		m_queue = std::unique_ptr<RenderQueue>(new RenderQueue(m_assets.getUniformBlockBinding("ObjectData")));
+
+		// Same cubes in one instanced draw
+		m_instances = std::unique_ptr<InstanceBuffer>(new InstanceBuffer());
+
+		// 100 x 100 grid of small cubes for comparing both paths
+		m_grid.reserve(100 * 100);
+		for (int y = 0; y < 100; y++)
+		{
+			for (int x = 0; x < 100; x++)
+				m_grid.create(glm::vec3(-0.99f + x * 0.02f, -0.99f + y * 0.02f, 0.5f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.01f));
+		}
+
+		// Robot in the middle and a crowd of small ones, all driven by the same clips
+		createRobotClips();
+		m_animation = std::unique_ptr<AnimationSystem>(new AnimationSystem(ROBOT_JOINT_COUNT));
+		m_crowdAnimation = std::unique_ptr<AnimationSystem>(new AnimationSystem(ROBOT_JOINT_COUNT));
+		glm::mat4 robotTransform = glm::mat4(1.0f);
+		robotTransform = glm::translate(robotTransform, glm::vec3(0.0f, 0.0f, 0.0f)); // Translation move robot ( not moving now. So, lies on the middle)
+		robotTransform = glm::rotate(robotTransform, glm::radians(-40.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotation in Y axis
+		robotTransform = glm::scale(robotTransform, glm::vec3(0.4f, 0.4f, 0.4f)); // Skalierung make the whole robot smaller.
+		m_robot = createRobot(robotTransform, *m_animation, 0.0f);
+		for (int y = 0; y < 32; y++)
+		{
+			for (int x = 0; x < 32; x++)
+			{
+				glm::mat4 root = glm::translate(glm::mat4(1.0f), glm::vec3(-0.95f + x * (1.9f / 31.0f), -0.95f + y * (1.9f / 31.0f), 0.0f));
+				root = glm::rotate(root, glm::radians(-40.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+				root = glm::scale(root, glm::vec3(0.016f));
+				m_crowd.push_back(createRobot(root, *m_crowdAnimation, (y * 32 + x) * 0.37f)); // out of step
+			}
+		}
+
+		// Same robots as skinned meshes: the palettes come straight from the poses, no scene graph
+		m_skinned = std::unique_ptr<SkinnedMeshBatch>(new SkinnedMeshBatch(m_assets.getUniformBlockBinding("SkinData"), ROBOT_JOINT_COUNT, 256, m_crowd.size()));
+		createSkinnedRobot();
+
 		glGenBuffers(1, &vboID); //ID generieren
-		glBindBuffer(GL_ARRAY_BUFFER, vboID ); //Buffer aktivieren
+		GLStateCache::bindBuffer(GL_ARRAY_BUFFER, vboID); //Buffer aktivieren
 		glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVert), &cubeVert, GL_STATIC_DRAW); // Hochladen der Daten auf die GPU
 
 		glGenVertexArrays(1, &vaoID); //ID generieren
-		glBindVertexArray(vaoID); //VAO aktivieren
+		GLStateCache::bindVertexArray(vaoID); //VAO aktivieren
 
 		// Define vertex attributes
 		// Positions
@@ -39,21 +119,32 @@ bool Scene::init()
 		//Create Index Buffer Object
 		GLuint iboID;
 		glGenBuffers(1, &iboID);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+		GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeInd), &cubeInd, GL_STATIC_DRAW);
 
+		// Instance matrices at attribute locations 4 - 7
+		m_instances->attach(vaoID);
+
+		// Cube again as static geometry, drawn with indirect commands
+		std::vector<VertexAttribute> cubeAtts;
+		cubeAtts.push_back(VertexAttribute{ 3, GL_FLOAT, 6 * sizeof(float), 0, GL_FALSE });
+		cubeAtts.push_back(VertexAttribute{ 3, GL_FLOAT, 6 * sizeof(float), 3 * sizeof(float), GL_FALSE });
+		m_static = std::unique_ptr<StaticGeometryBuffer>(new StaticGeometryBuffer(cubeAtts));
+		std::vector<Index> cubeIndices(std::begin(cubeInd), std::end(cubeInd));
+		m_cubeMesh = m_static->addMesh(cubeVert, sizeof(cubeVert) / (6 * sizeof(float)), cubeIndices.data(), cubeIndices.size());
+
 		//Unbind VAO
-		glBindVertexArray(0);
+		GLStateCache::bindVertexArray(0);
 		//Unbind VBO
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		GLStateCache::bindBuffer(GL_ARRAY_BUFFER, 0);
 
 		// Only the front sides of the triangles are rendered
-		glEnable(GL_CULL_FACE);
-		glCullFace(GL_BACK);
+		GLStateCache::enable(GL_CULL_FACE);
+		GLStateCache::cullFace(GL_BACK);
 
 		// Enable depth test
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_GREATER);
+		GLStateCache::enable(GL_DEPTH_TEST);
+		GLStateCache::depthFunc(GL_GREATER);
 		glClearDepth(0.0);
 		
 
@@ -72,117 +163,83 @@ void Scene::render(float dt)
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-	m_shader->use(); // Shader aktivieren
+	m_cubeMatrices.clear();
 
-	static float angle = 0.0f; // track of rotation angle.
-	angle += dt; // increment the angle based on delta time;
+	// world matrices of the subtrees animated since the last frame
+	m_graph.update();
+	for (SceneGraph::NodeId part : m_robot.parts)
+		m_cubeMatrices.push_back(m_graph.getWorldMatrix(part)); // collect matrix, uploaded below
+	if (m_showCrowd && !isGpuSkinning())
+	{
+		for (const Robot& robot : m_crowd)
+		{
+			for (SceneGraph::NodeId part : robot.parts)
+				m_cubeMatrices.push_back(m_graph.getWorldMatrix(part));
+		}
+	}
 
-	//create a rotation vector
-	glm::vec3 rotation( angle * 0.0f, angle * - 0.1f, 0.0f); // rotate on x and y axis
+	if (m_showGrid)
+	{
+		// composes only the cubes that changed since the last frame
+		m_grid.update();
+		m_cubeMatrices.insert(m_cubeMatrices.end(), m_grid.getMatrices(), m_grid.getMatrices() + m_grid.size());
+	}
 
-	/*
-	 // Apply the rotation to the transformation matrix
-	cubeTrans->setRotation(rotation);
+	if (m_multiDraw && m_instancedShader)
+		renderMultiDraw();
+	else if (m_instanced && m_instancedShader)
+		renderInstanced();
+	else
+		renderPerObject();
 
-	// Pass the transform matrix to the shader
-	m_shader->setUniform("modelMatrix", cubeTrans->getMatrix(), false);
-	*/
-
-	// Transformationsmatrix für den gesamten Roboter
-	glm::mat4 robotTransform = glm::mat4(1.0f);
-	robotTransform = glm::translate(robotTransform, glm::vec3(0.0f, 0.0f, 0.0f)); // Translation move robot ( not moving now. So, lies on the middle)
-	robotTransform = glm::rotate(robotTransform, glm::radians(-40.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotation in Y axis
-	robotTransform = glm::scale(robotTransform, glm::vec3(0.4f, 0.4f, 0.4f)); // Skalierung make the whole robot smaller.
-
-	// Transformationsmatrix für den Körper
-	Transform bodyTransform;
-	bodyTransform.scale(glm::vec3(1.0f, 1.5f, 0.5f)); //skalierung: stretch taller und thinner.
-	bodyTransform.setMatrix(robotTransform * bodyTransform.getMatrix()); // combines all transformation with the main robot transformation
-	m_shader->setUniform("modelMatrix", bodyTransform.getMatrix(), false); // send matrix to shader
-	glBindVertexArray(vaoID);
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0); // draw
-
-	//Transformationsmatrix für den Kopf
-	Transform headTransform;
-	headTransform.scale(glm::vec3(0.5f, 0.5f, 0.5f)); // skalierung : make head smaller
-	headTransform.translate(glm::vec3(0.0f, 1.25f, 0.0f)); //Translation: Move the head above body
-	headTransform.rotate(rotation); // rotation: rotate head
-	headTransform.setMatrix(robotTransform * headTransform.getMatrix()); // combines all transformation with the main robot transformation
-	m_shader->setUniform("modelMatrix", headTransform.getMatrix(), false);// send headmatrix to shader
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0); // draw
-
-	// Swinging leg animation
-	static float totalTime = 0.0f;
-	totalTime += dt;
-	float swingAngle = sin(totalTime) * glm::radians(30.0f); // swing angle for the legs.
-
-	// Transformationsmatrix für das linke Bein
-	Transform leftLegTransform;
-	leftLegTransform.scale(glm::vec3(0.5f, 1.0f, 0.5f)); // Bein ist lang und dünn
-	leftLegTransform.translate(glm::vec3(-0.25f, -1.25f, 0.0f)); // Move the left leg to the left and downward
-	leftLegTransform.rotateAroundPoint(glm::vec3(-0.25f, 0.0f, 0.0f), glm::vec3(swingAngle, 0.0f, 0.0f)); // Rotate around hip joint
-	leftLegTransform.setMatrix(robotTransform * leftLegTransform.getMatrix());
-	m_shader->setUniform("modelMatrix", leftLegTransform.getMatrix(), false);
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-	// Transformationsmatrix für das rechte Bein
-	Transform rightLegTransform;
-	rightLegTransform.scale(glm::vec3(0.5f, 1.0f, 0.5f)); // Rechts genauso wie links
-	rightLegTransform.translate(glm::vec3(0.25f, -1.25f, 0.0f)); //Move the right leg to the left and downward
-	rightLegTransform.rotateAroundPoint(glm::vec3(0.25f, 0.0f, 0.0f), glm::vec3(-swingAngle, 0.0f, 0.0f)); // Rotate around hip joint
-	rightLegTransform.setMatrix(robotTransform * rightLegTransform.getMatrix());
-	m_shader->setUniform("modelMatrix", rightLegTransform.getMatrix(), false);
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-	// Swinging arm animation
-	static float time = 0.0f;
-	time += dt;
-	float armSwingAngle = sin(totalTime) * glm::radians(20.0f);
-	// Transformationsmatrix für den linken Oberarm
-    Transform leftUpperArmTransform;
-    leftUpperArmTransform.scale(glm::vec3(0.2f, 0.75f, 0.25f)); // Oberarm ist dick und kurz
-    leftUpperArmTransform.translate(glm::vec3(-0.75f, 0.35f, 0.0f)); // Position des linken Oberarms
-    leftUpperArmTransform.rotateAroundPoint(glm::vec3(-1.0f, 1.0f, 0.0f), glm::vec3(armSwingAngle, 0.0f, 0.0f)); // Rotate around shoulder joint
-    leftUpperArmTransform.setMatrix(robotTransform * leftUpperArmTransform.getMatrix());
-    m_shader->setUniform("modelMatrix", leftUpperArmTransform.getMatrix(), false);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    // Transformationsmatrix für den rechten Oberarm
-    Transform rightUpperArmTransform;
-    rightUpperArmTransform.scale(glm::vec3(0.2f, 0.75f, 0.25f)); // Rechts genauso wie links
-    rightUpperArmTransform.translate(glm::vec3(0.75f, 0.35f, 0.0f)); // Position des rechten Oberarms
-    rightUpperArmTransform.rotateAroundPoint(glm::vec3(0.75f, 0.75f, 0.0f), glm::vec3(-armSwingAngle, 0.0f, 0.0f)); // Rotate around shoulder joint
-    rightUpperArmTransform.setMatrix(robotTransform * rightUpperArmTransform.getMatrix());
-    m_shader->setUniform("modelMatrix", rightUpperArmTransform.getMatrix(), false);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    // Transformationsmatrix für den linken Unterarm
-    Transform leftLowerArmTransform;
-    leftLowerArmTransform.scale(glm::vec3(1.0f, 1.0f, 1.0f)); // Unterarm ist gleich groß wie der Oberarm
-    leftLowerArmTransform.translate(glm::vec3(0.0f, -1.0f, 0.0f)); // Position des linken Unterarms
-    leftLowerArmTransform.rotateAroundPoint(glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(armSwingAngle, 0.0f, 0.0f)); // Rotate around elbow joint
-    leftLowerArmTransform.setMatrix(leftUpperArmTransform.getMatrix() * leftLowerArmTransform.getMatrix());
-    m_shader->setUniform("modelMatrix", leftLowerArmTransform.getMatrix(), false);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    // Transformationsmatrix für den rechten Unterarm
-    Transform rightLowerArmTransform;
-    rightLowerArmTransform.scale(glm::vec3(1.0f, 1.0f, 1.0f)); // Rechts genauso wie links
-    rightLowerArmTransform.translate(glm::vec3(0.0f, -1.0f, 0.0f)); // Position des rechten Unterarms
-    rightLowerArmTransform.rotateAroundPoint(glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(-armSwingAngle, 0.0f, 0.0f)); // Rotate around elbow joint
-    rightLowerArmTransform.setMatrix(rightUpperArmTransform.getMatrix() * rightLowerArmTransform.getMatrix());
-    m_shader->setUniform("modelMatrix", rightLowerArmTransform.getMatrix(), false);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+	if (m_showCrowd && isGpuSkinning())
+		renderSkinnedCrowd();
+}
 
-	// Bind VAO
-	glBindVertexArray(vaoID);
+bool Scene::isGpuSkinning() const
+{
+	return m_gpuSkinning && m_skinnedShader;
+}
 
-	// Draw triangle
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+void Scene::renderPerObject()
+{
+	// Every cube is one packet, the queue sorts them and sets state only where it changes
+	DrawPacket packet;
+	packet.shader = m_shader;
+	packet.vao = vaoID;
+	packet.indexCount = 36;
+	packet.indexType = GL_UNSIGNED_SHORT;
+	for (const auto& matrix : m_cubeMatrices)
+	{
+		packet.transform = matrix;
+		// no camera yet: depth from clip space z, greater z is nearer (GL_GREATER)
+		packet.depth = glm::clamp(0.5f - 0.5f * matrix[3][2], 0.0f, 1.0f);
+		m_queue->submit(packet);
+	}
+	m_queue->flush();
+}
 
-	// Unbind VAO
-	glBindVertexArray(0);
+void Scene::renderInstanced()
+{
+	m_instancedShader->use();
+
+	// Upload all model matrices as instance data and draw every cube with one call
+	m_instances->update(m_cubeMatrices.data(), m_cubeMatrices.size());
+	GLStateCache::bindVertexArray(vaoID);
+	m_instances->drawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT);
+	GLStateCache::bindVertexArray(0);
+}
+void Scene::renderMultiDraw()
+{
+	m_instancedShader->use();
+
+	// Every visible object is added to the draw list, equal meshes end up in one indirect command
+	m_static->clearDraws();
+	for (const auto& matrix : m_cubeMatrices)
+		m_static->addDraw(m_cubeMesh, matrix);
+	m_static->draw();
 }
+
 /*void Scene::render(float dt)
 {
 	// Hintergrund löschen
@@ -203,18 +260,201 @@ void Scene::render(float dt)
 	m_shader->setUniform("modelMatrix", cubeTrans->getMatrix(), false);
 
 	// Bind VAO
-	glBindVertexArray(vaoID);
+	GLStateCache::bindVertexArray(vaoID);
 
 	// Draw triangle
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
 
 	// Unbind VAO
-	glBindVertexArray(0);
+	GLStateCache::bindVertexArray(0);
 }*/
 
 void Scene::update(float dt)
 {
+	// finish shader variants compiled in the background
+	m_assets.updatePendingShaderPrograms();
+	if (!m_instancedShader)
+		m_instancedShader = m_assets.findShaderProgram(m_instancedVariant);
+	if (!m_skinnedShader)
+		m_skinnedShader = m_assets.findShaderProgram(m_skinnedVariant);
+
+	// sample the clips and hand the joint poses to the scene graph
+	m_animation->update(dt);
+	applyPose(m_robot, *m_animation);
+	if (m_showCrowd)
+	{
+		m_crowdAnimation->update(dt);
+		// skinned robots read the poses in render, the scene graph is left alone
+		if (!isGpuSkinning())
+		{
+			for (const Robot& robot : m_crowd)
+				applyPose(robot, *m_crowdAnimation);
+		}
+	}
+}
+
+void Scene::createRobotClips()
+{
+	// one head turn at 0.1 rad/s takes 20 pi seconds, the limbs swing 10 times meanwhile
+	const float duration = 20.0f * glm::pi<float>();
+	m_walkClip = std::unique_ptr<AnimationClip>(new AnimationClip("walk", duration, ROBOT_JOINT_COUNT));
+	m_idleClip = std::unique_ptr<AnimationClip>(new AnimationClip("idle", duration, ROBOT_JOINT_COUNT));
+
+	// joint positions relative to the robot (upper arm for the elbows) are the same in both clips
+	const glm::vec3 pivots[ROBOT_JOINT_COUNT] = {
+		glm::vec3(0.0f),				// root, not animated
+		glm::vec3(0.0f, 1.25f, 0.0f),	// neck
+		glm::vec3(-0.25f, 0.0f, 0.0f),	// hip joints
+		glm::vec3(0.25f, 0.0f, 0.0f),
+		glm::vec3(-1.0f, 1.0f, 0.0f),	// shoulder joints
+		glm::vec3(0.75f, 0.75f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),	// elbow joints
+		glm::vec3(0.0f, -1.0f, 0.0f) };
+	for (int j = 0; j < ROBOT_JOINT_COUNT; j++)
+	{
+		m_walkClip->addPositionKey(j, 0.0f, pivots[j]);
+		m_idleClip->addPositionKey(j, 0.0f, pivots[j]);
+	}
+
+	// head turns around y in both, quarter turns slerp at constant speed
+	for (int k = 0; k <= 4; k++)
+	{
+		glm::quat turn = glm::angleAxis(k * -0.5f * glm::pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+		m_walkClip->addRotationKey(NECK, k * duration / 4.0f, turn);
+		m_idleClip->addRotationKey(NECK, k * duration / 4.0f, turn);
+	}
 
+	// swinging around x: amplitude * sin(2 pi t / period), 16 keys per period
+	auto addSwing = [duration](AnimationClip& clip, int joint, float amplitude, float period)
+	{
+		int keys = static_cast<int>(duration / period * 16.0f + 0.5f);
+		for (int k = 0; k <= keys; k++)
+		{
+			float t = k * duration / keys;
+			float angle = amplitude * sin(t * 2.0f * glm::pi<float>() / period);
+			clip.addRotationKey(joint, t, glm::angleAxis(angle, glm::vec3(1.0f, 0.0f, 0.0f)));
+		}
+	};
+	const float step = 2.0f * glm::pi<float>();
+	addSwing(*m_walkClip, LEFT_HIP, glm::radians(30.0f), step);
+	addSwing(*m_walkClip, RIGHT_HIP, glm::radians(-30.0f), step);
+	addSwing(*m_walkClip, LEFT_SHOULDER, glm::radians(20.0f), step);
+	addSwing(*m_walkClip, RIGHT_SHOULDER, glm::radians(-20.0f), step);
+	addSwing(*m_walkClip, LEFT_ELBOW, glm::radians(20.0f), step);
+	addSwing(*m_walkClip, RIGHT_ELBOW, glm::radians(-20.0f), step);
+
+	// idle: legs still, arms sway slowly
+	addSwing(*m_idleClip, LEFT_SHOULDER, glm::radians(4.0f), 2.0f * step);
+	addSwing(*m_idleClip, RIGHT_SHOULDER, glm::radians(-4.0f), 2.0f * step);
+	addSwing(*m_idleClip, LEFT_ELBOW, glm::radians(5.0f), 2.0f * step);
+	addSwing(*m_idleClip, RIGHT_ELBOW, glm::radians(-5.0f), 2.0f * step);
+}
+
+Scene::Robot Scene::createRobot(const glm::mat4 & root, AnimationSystem & animation, float time)
+{
+	Robot robot;
+	robot.root = root;
+	SceneGraph::NodeId robotNode = m_graph.createNode(SceneGraph::INVALID_NODE, root);
+	robot.joints[ROOT] = m_graph.createNode(robotNode);
+	for (int j = NECK; j <= RIGHT_SHOULDER; j++)
+		robot.joints[j] = m_graph.createNode(robot.joints[ROOT]);
+
+	// the cubes hang below the joints
+	robot.parts.resize(ROBOT_CUBE_COUNT);
+	for (int c = BODY; c <= RIGHT_UPPER_ARM; c++)
+		robot.parts[c] = m_graph.createNode(robot.joints[cubeJoints[c]], cubeMatrix(c));
+	// the elbows hang at the upper arm cubes, the lower arms get their scale
+	robot.joints[LEFT_ELBOW] = m_graph.createNode(robot.parts[LEFT_UPPER_ARM]);
+	robot.joints[RIGHT_ELBOW] = m_graph.createNode(robot.parts[RIGHT_UPPER_ARM]);
+	for (int c = LEFT_LOWER_ARM; c <= RIGHT_LOWER_ARM; c++)
+		robot.parts[c] = m_graph.createNode(robot.joints[cubeJoints[c]], cubeMatrix(c));
+
+	robot.animation = animation.createInstance(m_walking ? m_walkClip.get() : m_idleClip.get(), time);
+	applyPose(robot, animation);
+	return robot;
+}
+
+void Scene::applyPose(const Robot & robot, const AnimationSystem & animation)
+{
+	const JointPose* pose = animation.getPose(robot.animation);
+	for (int j = 0; j < ROBOT_JOINT_COUNT; j++)
+		m_graph.setLocalMatrix(robot.joints[j], pose[j].toMatrix());
+}
+
+void Scene::createSkinnedRobot()
+{
+	// rig of the scene graph robots: elbows with the upper arm cube as fixed offset
+	m_skeleton.addJoint(Skeleton::NO_PARENT);
+	for (int j = NECK; j <= RIGHT_SHOULDER; j++)
+		m_skeleton.addJoint(ROOT);
+	m_skeleton.addJoint(LEFT_SHOULDER, cubeMatrix(LEFT_UPPER_ARM));
+	m_skeleton.addJoint(RIGHT_SHOULDER, cubeMatrix(RIGHT_UPPER_ARM));
+	JointPose bindPose[ROBOT_JOINT_COUNT];
+	m_walkClip->sample(0.0f, bindPose);
+	m_skeleton.setBindPose(bindPose);
+
+	// one mesh of all 8 cubes in the bind pose, every cube rigidly bound to its joint
+	struct SkinnedCubeVertex
+	{
+		float position[3];
+		float color[3];
+		VertexSkin skin;
+	};
+	const size_t cubeVertices = sizeof(cubeVert) / (6 * sizeof(float));
+	std::vector<SkinnedCubeVertex> vertices;
+	std::vector<GLushort> indices;
+	for (int c = 0; c < ROBOT_CUBE_COUNT; c++)
+	{
+		glm::mat4 bind = m_skeleton.getBindMatrix(cubeJoints[c]) * cubeMatrix(c);
+		GLushort first = static_cast<GLushort>(vertices.size());
+		for (size_t v = 0; v < cubeVertices; v++)
+		{
+			SkinnedCubeVertex vertex;
+			glm::vec3 position(bind * glm::vec4(cubeVert[v * 6], cubeVert[v * 6 + 1], cubeVert[v * 6 + 2], 1.0f));
+			vertex.position[0] = position.x;
+			vertex.position[1] = position.y;
+			vertex.position[2] = position.z;
+			vertex.color[0] = cubeVert[v * 6 + 3];
+			vertex.color[1] = cubeVert[v * 6 + 4];
+			vertex.color[2] = cubeVert[v * 6 + 5];
+			vertex.skin = Skinning::packInfluences(glm::uvec4(cubeJoints[c], 0, 0, 0), glm::vec4(1.0f, 0.0f, 0.0f, 0.0f));
+			vertices.push_back(vertex);
+		}
+		for (GLushort index : cubeInd)
+			indices.push_back(first + index);
+	}
+	m_skinnedIndexCount = static_cast<GLsizei>(indices.size());
+
+	GLuint vbo, ibo;
+	glGenVertexArrays(1, &m_skinnedVao);
+	GLStateCache::bindVertexArray(m_skinnedVao);
+	glGenBuffers(1, &vbo);
+	GLStateCache::bindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SkinnedCubeVertex), vertices.data(), GL_STATIC_DRAW);
+	glGenBuffers(1, &ibo);
+	GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedCubeVertex), (void*)offsetof(SkinnedCubeVertex, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedCubeVertex), (void*)offsetof(SkinnedCubeVertex, color));
+	glEnableVertexAttribArray(1);
+	// joint indices as plain numbers, weights as unorm8
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(SkinnedCubeVertex), (void*)(offsetof(SkinnedCubeVertex, skin) + offsetof(VertexSkin, joints)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinnedCubeVertex), (void*)(offsetof(SkinnedCubeVertex, skin) + offsetof(VertexSkin, weights)));
+	glEnableVertexAttribArray(3);
+	GLStateCache::bindVertexArray(0);
+	GLStateCache::bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Scene::renderSkinnedCrowd()
+{
+	// palettes from the poses: model * posed joint * inverse bind, 32 robots per instanced draw
+	m_skinnedShader->use();
+	m_skinned->clear();
+	for (const Robot& robot : m_crowd)
+		m_skeleton.computePalette(m_crowdAnimation->getPose(robot.animation), m_skinned->addInstance(), robot.root);
+	m_skinned->draw(m_skinnedVao, GL_TRIANGLES, m_skinnedIndexCount, GL_UNSIGNED_SHORT);
 }
 
 OpenGLWindow * Scene::getWindow()
@@ -224,6 +464,53 @@ OpenGLWindow * Scene::getWindow()
 
 void Scene::onKey(Key key, Action action, Modifier modifier)
 {
+	if (key == Key::I && action == Action::Down)
+	{
+		m_instanced = !m_instanced;
+		std::cout << (m_instanced ? "Instanced rendering\n" : "One draw call per cube\n");
+	}
+	if (key == Key::M && action == Action::Down)
+	{
+		m_multiDraw = !m_multiDraw;
+		std::cout << (m_multiDraw ? "Static geometry, multi draw indirect\n" : "Static geometry off\n");
+	}
+	if (key == Key::G && action == Action::Down)
+	{
+		m_showGrid = !m_showGrid;
+		std::cout << (m_showGrid ? "Showing 10k cube grid\n" : "Hiding 10k cube grid\n");
+	}
+	if (key == Key::C && action == Action::Down)
+	{
+		m_showCrowd = !m_showCrowd;
+		std::cout << (m_showCrowd ? "Showing robot crowd\n" : "Hiding robot crowd\n");
+	}
+	if (key == Key::K && action == Action::Down)
+	{
+		m_gpuSkinning = !m_gpuSkinning;
+		std::cout << (m_gpuSkinning ? "Crowd skinned on the GPU\n" : "Crowd as scene graph cubes\n");
+	}
+	if (key == Key::A && action == Action::Down)
+	{
+		// crossfade, the new clip starts in step with the old one
+		m_walking = !m_walking;
+		const AnimationClip* clip = m_walking ? m_walkClip.get() : m_idleClip.get();
+		m_animation->play(m_robot.animation, clip, 0.5f, true);
+		for (const Robot& robot : m_crowd)
+			m_crowdAnimation->play(robot.animation, clip, 0.5f, true);
+		std::cout << "Robots " << clip->getName() << "\n";
+	}
+	if (key == Key::S && action == Action::Down)
+	{
+		const RenderQueue::Stats& stats = m_queue->getStats();
+		GLStateCache::Stats state = GLStateCache::getFrameStats();
+		std::cout << "Render queue: " << stats.packets << " packets, " << stats.drawCalls << " draw calls, "
+			<< stats.programChanges << " program / " << stats.vaoChanges << " vao / " << stats.textureChanges << " texture changes, "
+			<< "sort " << stats.sortTime << " ms\n"
+			<< "GL state: " << state.issued << " issued, " << state.elided << " elided\n"
+			<< "Scene graph: " << m_graph.getUpdatedCount() << " of " << m_graph.getNodeCount() << " world matrices updated\n"
+			<< "Animation: " << m_animation->getSampledCount() + (m_showCrowd ? m_crowdAnimation->getSampledCount() : 0) << " instances sampled\n"
+			<< "Skinning: " << m_skinned->getInstanceCount() << " instances in " << m_skinned->getDrawCalls() << " draw calls\n";
+	}
 
 }
 
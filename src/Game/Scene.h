@@ -2,9 +2,20 @@
 
 #include "OpenGLWindow.h"
 #include <ShaderProgram.h>
+#include <GLStateCache.h>
+#include <RenderQueue.h>
+#include <InstanceBuffer.h>
+#include <StaticGeometryBuffer.h>
+#include <vector>
 #include <memory>
 #include <AssetManager.h>
 #include "Transform.h"
+#include "SceneGraph.h"
+#include "TransformSystem.h"
+#include <AnimationClip.h>
+#include <AnimationSystem.h>
+#include <Skeleton.h>
+#include <SkinnedMeshBatch.h>
 
 class Scene
 {
@@ -26,11 +37,60 @@ public:
 	void onMouseScroll(double xscroll, double yscroll);
 	void onFrameBufferResize(int width, int height);
 
+	// joints of the robot rig, animated by the clips. Parents come first (Skeleton).
+	enum RobotJoint { ROOT, NECK, LEFT_HIP, RIGHT_HIP, LEFT_SHOULDER, RIGHT_SHOULDER, LEFT_ELBOW, RIGHT_ELBOW, ROBOT_JOINT_COUNT };
+
 private:
 	OpenGLWindow* m_window;
 	AssetManager m_assets;
     ShaderProgram* m_shader;
+    std::unique_ptr<RenderQueue> m_queue; // sorted per object draws
+    std::vector<glm::mat4> m_cubeMatrices; // model matrices of the cubes drawn this frame
+    std::string m_instancedVariant;
+    ShaderProgram* m_instancedShader; // nullptr until the variant is linked, the cubes are drawn per object meanwhile
+    std::unique_ptr<InstanceBuffer> m_instances; // per instance model matrices
+    TransformSystem m_grid; // stress test: 10k small cubes
+    std::unique_ptr<StaticGeometryBuffer> m_static; // cube mesh in the shared static buffers
+    size_t m_cubeMesh;
+    bool m_instanced; // I: one instanced draw instead of one draw per cube
+    bool m_multiDraw; // M: static geometry with indirect draws, overrides I
+    bool m_showGrid; // G: add the 10k cube grid
+    SceneGraph m_graph; // robot hierarchies, world matrices are cached between frames
+
+    struct Robot
+    {
+        glm::mat4 root;
+        SceneGraph::NodeId joints[ROBOT_JOINT_COUNT];
+        std::vector<SceneGraph::NodeId> parts; // drawn cubes in draw order, hanging below the joints
+        AnimationSystem::InstanceId animation;
+    };
+    std::unique_ptr<AnimationClip> m_walkClip;
+    std::unique_ptr<AnimationClip> m_idleClip;
+    std::unique_ptr<AnimationSystem> m_animation; // the robot in the middle
+    std::unique_ptr<AnimationSystem> m_crowdAnimation;
+    Robot m_robot;
+    std::vector<Robot> m_crowd; // C: 32 x 32 small robots
+    bool m_showCrowd;
+    bool m_walking; // A: crossfade between walking and idle
+    Skeleton m_skeleton; // robot rig for skinning
+    std::unique_ptr<SkinnedMeshBatch> m_skinned; // crowd palettes, skinned on the GPU
+    std::string m_skinnedVariant;
+    ShaderProgram* m_skinnedShader; // nullptr until the variant is linked, the crowd stays on the scene graph meanwhile
+    GLuint m_skinnedVao;
+    GLsizei m_skinnedIndexCount;
+    bool m_gpuSkinning; // K: crowd as one skinned mesh per robot instead of 8 cubes through the scene graph
     GLuint vaoID, vboID;
 
+    bool isGpuSkinning() const; // K is on and the skinning variant is linked
+    void renderPerObject();
+    void renderInstanced();
+    void renderMultiDraw();
+
+    void createRobotClips();
+    Robot createRobot(const glm::mat4& root, AnimationSystem& animation, float time);
+    void applyPose(const Robot& robot, const AnimationSystem& animation);
+    void createSkinnedRobot();
+    void renderSkinnedCrowd();
+
 };
 
@@ -42,6 +42,7 @@ void Window::update(GLdouble dtime)
 //Render a frame
 void Window::render(GLdouble dtime)
 {
+	GLStateCache::beginFrame();
 	m_scene->render(static_cast<float>(dtime));
 }
 
@@ -0,0 +1,78 @@
+//AnimationClip::sample with a cursor must give exactly the poses of the binary search without one, for every order of
+//sample times: small and large steps forward, jumps back, loop wraps, times outside the keys and times on a key.
+//The tracks have irregular key times, different key counts per track, single key and empty tracks.
+#include <AnimationClip.h>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	const uint32_t JOINTS = 6;
+	const float DURATION = 4.0f;
+
+	AnimationClip createClip()
+	{
+		AnimationClip clip("test", DURATION, JOINTS);
+		for (uint32_t j = 0; j < JOINTS; j++)
+		{
+			//irregular spacing, more keys for later joints
+			uint32_t keys = 2 + j * 7;
+			float time = 0.0f;
+			for (uint32_t k = 0; k < keys; k++)
+			{
+				clip.addPositionKey(j, time, glm::vec3(std::sin(time * 3.0f), k * 0.1f, j));
+				clip.addRotationKey(j, time * 0.5f, glm::angleAxis(time + j, glm::normalize(glm::vec3(1.0f, j + 1.0f, 0.5f))));
+				time += DURATION / keys * (0.25f + (k % 3) * 0.75f);
+			}
+		}
+		//one joint with a constant scale, the others without scale keys
+		clip.addScaleKey(2, 1.0f, glm::vec3(2.0f, 1.0f, 0.5f));
+		return clip;
+	}
+
+	bool equal(const JointPose& a, const JointPose& b)
+	{
+		return a.position == b.position && a.rotation == b.rotation && a.scale == b.scale;
+	}
+}
+
+int main()
+{
+	AnimationClip clip = createClip();
+
+	std::vector<float> times;
+	for (int i = 0; i <= 400; i++)
+		times.push_back(i * 0.01f);			//forward in small steps
+	for (int i = 0; i <= 40; i++)
+		times.push_back(std::fmod(i * 0.73f, DURATION));	//large steps with wraps
+	for (int i = 40; i >= 0; i--)
+		times.push_back(i * 0.1f);			//backwards
+	const float edges[] = { -1.0f, 0.0f, 0.5f, 0.5f, 1.0f, DURATION, DURATION + 1.0f, 0.001f, 3.999f, 2.0f };
+	times.insert(times.end(), std::begin(edges), std::end(edges));
+
+	std::vector<uint32_t> cursor(clip.getCursorSize(), 0);
+	std::vector<JointPose> cached(JOINTS), searched(JOINTS);
+	int failures = 0;
+	for (size_t i = 0; i < times.size(); i++)
+	{
+		clip.sample(times[i], cached.data(), cursor.data());
+		clip.sample(times[i], searched.data());
+		for (uint32_t j = 0; j < JOINTS; j++)
+		{
+			if (!equal(cached[j], searched[j]))
+			{
+				std::printf("sample %zu (time %f), joint %u: cursor and binary search differ\n", i, times[i], j);
+				failures++;
+			}
+		}
+	}
+
+	if (failures > 0)
+	{
+		std::printf("%d poses differ\n", failures);
+		return 1;
+	}
+	std::printf("%zu samples of %u joints equal\n", times.size(), JOINTS);
+	return 0;
+}
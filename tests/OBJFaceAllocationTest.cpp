@@ -0,0 +1,110 @@
+//Counts heap allocations per face while loading OBJ files with both parsers.
+//Face parsing must not allocate. Two files with the same vertex data that differ only in their face count must therefore
+//cost almost the same number of allocations; only the logarithmic growth of the result vectors may differ.
+//The faces are quads with negative indices, so n-gon triangulation and relative indices are covered as well.
+#include <OBJLoader.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+
+namespace
+{
+	size_t allocations = 0;
+
+	//vertices of a size x size quad grid followed by the first quads of it, referenced with negative indices
+	void writeQuadOBJ(const std::string& path, int size, int quads)
+	{
+		std::ofstream stream(path);
+		stream << "o quads\ng surface\n";
+		for (int y = 0; y <= size; y++)
+		{
+			for (int x = 0; x <= size; x++)
+				stream << "v " << x << " " << y << " 0\n";
+		}
+		stream << "vt 0 0\nvn 0 0 1\n";
+		int count = (size + 1) * (size + 1);
+		for (int q = 0; q < quads; q++)
+		{
+			int a = (q / size) * (size + 1) + q % size - count;	//-count is the first vertex
+			int c = a + size + 1;
+			stream << "f " << a << "/-1/-1 " << a + 1 << "/-1/-1 " << c + 1 << "/-1/-1 " << c << "/-1/-1\n";
+		}
+	}
+
+	size_t countAllocations(const std::function<OBJResult()>& load, size_t& triangles)
+	{
+		size_t before = allocations;
+		OBJResult result = load();
+		size_t count = allocations - before;
+		triangles = 0;
+		for (const auto& object : result.objects)
+		{
+			for (const auto& mesh : object.meshes)
+				triangles += mesh.indices.size() / 3;
+		}
+		return count;
+	}
+
+	bool check(const char* name, const std::function<OBJResult(const std::string&)>& load, const std::string& small, const std::string& large, size_t faces)
+	{
+		size_t smalltris, largetris;
+		size_t smallcount = countAllocations([&]() { return load(small); }, smalltris);
+		size_t largecount = countAllocations([&]() { return load(large); }, largetris);
+		double perface = (static_cast<double>(largecount) - static_cast<double>(smallcount)) / static_cast<double>(faces);
+		std::printf("%s: %zu / %zu allocations, %.4f per face\n", name, smallcount, largecount, perface);
+		if (largetris - smalltris != faces * 2)
+		{
+			std::printf("%s: expected two triangles per quad, got %zu\n", name, largetris - smalltris);
+			return false;
+		}
+		//vector growth adds a few allocations per doubling, the old parser needed about 10 per face
+		if (perface > 0.01)
+		{
+			std::printf("%s: faces allocate\n", name);
+			return false;
+		}
+		return true;
+	}
+}
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void* p = std::malloc(size > 0 ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+int main()
+{
+	try
+	{
+		const int size = 150;
+		const int smallquads = 1000;
+		writeQuadOBJ("alloc_test_small.obj", size, smallquads);
+		writeQuadOBJ("alloc_test_large.obj", size, size * size);
+		size_t faces = static_cast<size_t>(size * size - smallquads);
+
+		bool ok = check("loadOBJMapped", [](const std::string& path) { return OBJLoader::loadOBJMapped(path); },
+			"alloc_test_small.obj", "alloc_test_large.obj", faces);
+		ok = check("loadOBJ", [](const std::string& path) { return OBJLoader::loadOBJ(path); },
+			"alloc_test_small.obj", "alloc_test_large.obj", faces) && ok;
+		std::remove("alloc_test_small.obj");
+		std::remove("alloc_test_large.obj");
+		return ok ? 0 : 1;
+	}
+	catch (const std::exception& ex)
+	{
+		std::printf("%s\n", ex.what());
+		return 1;
+	}
+}
@@ -0,0 +1,92 @@
+//setMatrix stores the matrix and decomposes it on the first getPosition, getRotation or getScale call.
+//Matrices with non-unit and non-uniform scale must come back as the position, rotation and scale they were built from,
+//and must survive edits that need the decomposition (setRotation) or work on the matrix directly (translate, rotate, scale).
+#include <Transform.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	int failures = 0;
+
+	float maxDifference(const glm::mat4& a, const glm::mat4& b)
+	{
+		float difference = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+				difference = std::max(difference, std::abs(a[c][r] - b[c][r]));
+		}
+		return difference;
+	}
+
+	void expect(bool condition, const char* what, int i)
+	{
+		if (!condition)
+		{
+			std::printf("case %d: %s\n", i, what);
+			failures++;
+		}
+	}
+
+	glm::mat4 trs(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+	{
+		return glm::translate(position) * glm::toMat4(rotation) * glm::scale(scale);
+	}
+}
+
+int main()
+{
+	const float epsilon = 1e-5f;
+	for (int i = 0; i < 1000; i++)
+	{
+		//deterministic spread of positions, axes, angles and scales between 0.1 and 5
+		glm::vec3 position(std::sin(i * 1.3f) * 10.0f, std::cos(i * 0.7f) * 10.0f, i * 0.01f - 5.0f);
+		glm::vec3 axis = glm::normalize(glm::vec3(std::sin(i * 0.3f), std::cos(i * 0.5f), 0.5f + std::sin(i * 0.11f)));
+		glm::quat rotation = glm::angleAxis(i * 0.37f, axis);
+		glm::vec3 scale(0.1f + (i % 7) * 0.8f, 0.5f + (i % 3) * 1.5f, 0.25f + (i % 5) * 0.5f);
+
+		Transform transform;
+		transform.setMatrix(trs(position, rotation, scale));
+		const glm::vec3& p = transform.getPosition();
+		const glm::quat& q = transform.getRotation();
+		const glm::vec3& s = transform.getScale();
+		expect(glm::length(p - position) < epsilon * 10.0f, "position differs", i);
+		expect(glm::length(s - scale) < epsilon * 10.0f, "scale differs", i);
+		//q and -q are the same rotation
+		expect(std::abs(std::abs(glm::dot(q, rotation)) - 1.0f) < epsilon, "rotation differs", i);
+		expect(maxDifference(transform.getMatrix(), trs(position, rotation, scale)) < epsilon * 10.0f, "matrix changed by the decomposition", i);
+
+		//edit through the decomposition: position and scale must be kept
+		glm::quat other = glm::angleAxis(i * 0.11f, glm::vec3(0.0f, 1.0f, 0.0f));
+		Transform decomposed;
+		decomposed.setMatrix(trs(position, rotation, scale));
+		decomposed.setRotation(other);
+		expect(maxDifference(decomposed.getMatrix(), trs(position, other, scale)) < epsilon * 10.0f, "setRotation after setMatrix", i);
+
+		//edits on the stored matrix must match the same edits on position, rotation and scale
+		glm::vec3 delta(1.0f, -2.0f, 0.5f);
+		glm::quat turn = glm::angleAxis(0.3f, glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::vec3 factor(2.0f, 0.5f, 1.5f);
+		Transform matrixMode;
+		matrixMode.setMatrix(trs(position, rotation, scale));
+		matrixMode.translate(delta);
+		matrixMode.rotate(turn);
+		matrixMode.scale(factor);
+		Transform trsMode(position, rotation, scale);
+		trsMode.translate(delta);
+		trsMode.rotate(turn);
+		trsMode.scale(factor);
+		expect(maxDifference(matrixMode.getMatrix(), trsMode.getMatrix()) < epsilon * 10.0f, "matrix mode edits differ", i);
+		expect(glm::length(matrixMode.getScale() - scale * factor) < epsilon * 10.0f, "scale after matrix mode edits", i);
+	}
+
+	if (failures > 0)
+	{
+		std::printf("%d checks failed\n", failures);
+		return 1;
+	}
+	std::printf("all checks passed\n");
+	return 0;
+}